@@ -55,6 +55,17 @@ enum ins_opcode_t
 	READ,  // Write data to a byte on memory
 	WRITE, // Read data from a byte on memory
 	SYSCALL,
+	READ16,  // Multi-byte (little endian) loads and stores
+	READ32,
+	READ64,
+	WRITE16,
+	WRITE32,
+	WRITE64,
+	REALLOC, // Resize an allocated memory block
+	MEMCPY,  // Bulk copy and fill of a memory block
+	MEMSET,
+	SUBMIT,  // Queue a syscall on the ring, entered as one batch
+	ENTER,
 };
 
 /* instructions executed by the CPU */
@@ -96,6 +107,8 @@ struct page_table_t
 	int size; // Number of row in the first layer
 };
 
+#define PCB_NR_REGS 10
+
 /* PCB, describe information about a process */
 struct pcb_t
 {
@@ -103,7 +116,7 @@ struct pcb_t
 	uint32_t priority;	 // Default priority, this legacy process based (FIXED)
 	char path[100];
 	struct code_seg_t *code; // Code segment
-	addr_t regs[10];	 // Registers, store address of allocated regions
+	addr_t regs[PCB_NR_REGS]; // Registers, store address of allocated regions
 	uint32_t pc;		 // Program pointer, point to the next instruction
 #ifdef MLQ_SCHED
 	// Priority on execution (if supported), on-fly aka. changeable
@@ -111,6 +124,7 @@ struct pcb_t
 	uint32_t prio;
 #endif
 	struct mm_struct *mm;
+	struct sc_ring *sc_ring; // Batched syscalls, see libsyscall_submit()
 struct pcb_t *owner; // <--- BẮT BUỘC THÊM DÒNG NÀY
 	struct krnl_t *krnl;	
 	struct page_table_t *page_table; // Page table
@@ -122,6 +136,9 @@ struct krnl_t
 {
 	struct queue_t *ready_queue;
 	struct queue_t *running_list;
+	/* PID -> PCB, kept by add_proc() and exit_proc() */
+	struct pcb_t **pid_tbl;
+	uint32_t pid_tbl_sz;
 #ifdef MLQ_SCHED
 	struct queue_t *mlq_ready_queue;
 #endif
@@ -15,9 +15,19 @@
 #define SYSMEM_SWP_OP 3
 #define SYSMEM_IO_READ 4
 #define SYSMEM_IO_WRITE 5
+#define SYSMEM_IO_COPY 6
+#define SYSMEM_IO_SET 7
 
 extern struct vm_area_struct *get_vma_by_num(struct mm_struct *mm, int vmaid);
-int liballoc(struct pcb_t *, addr_t, uint32_t);
+int liballoc(struct pcb_t *, int, addr_t, uint32_t);
+int librealloc(struct pcb_t *, addr_t, uint32_t);
 int libfree(struct pcb_t *, uint32_t);
 int libread(struct pcb_t*, uint32_t, addr_t, uint32_t*);
 int libwrite(struct pcb_t*, BYTE, uint32_t, addr_t);
+int libmemcpy(struct pcb_t*, uint32_t, uint32_t, addr_t, addr_t);
+int libmemset(struct pcb_t*, BYTE, uint32_t, addr_t, addr_t);
+int libread_n(struct pcb_t*, uint32_t, addr_t, int, uint64_t*);
+int libwrite_n(struct pcb_t*, uint64_t, uint32_t, addr_t, int);
+void tlb_clear_entry(int pid, int pgn);
+int free_pcb_memph(struct pcb_t *caller);
+int pg_getpage(struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller);
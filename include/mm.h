@@ -21,6 +21,8 @@
 #define PAGING_PTE_DIRTY_MASK BIT(28)
 #define PAGING_PTE_EMPTY01_MASK BIT(14)
 #define PAGING_PTE_EMPTY02_MASK BIT(13)
+/* Present page brought in by swap readahead and not accessed yet */
+#define PAGING_PTE_READAHEAD_MASK PAGING_PTE_RESERVE_MASK
 
 /* PTE BIT PRESENT */
 #define PAGING_PTE_SET_PRESENT(pte) (pte=pte|PAGING_PTE_PRESENT_MASK)
@@ -29,27 +31,36 @@
 /* USRNUM */
 #define PAGING_PTE_USRNUM_LOBIT 15
 #define PAGING_PTE_USRNUM_HIBIT 27
-/* FPN */
+/* FPN - a present page has no swap fields, its frame number takes their bits */
 #define PAGING_PTE_FPN_LOBIT 0
-#define PAGING_PTE_FPN_HIBIT 12
+#define PAGING_PTE_FPN_HIBIT 25
+#define PAGING_MAX_FPN BIT(PAGING_PTE_FPN_HIBIT - PAGING_PTE_FPN_LOBIT + 1)
 /* SWPTYP */
 #define PAGING_PTE_SWPTYP_LOBIT 0
 #define PAGING_PTE_SWPTYP_HIBIT 4
 /* SWPOFF */
 #define PAGING_PTE_SWPOFF_LOBIT 5
 #define PAGING_PTE_SWPOFF_HIBIT 25
+#define PAGING_MAX_SWPOFF BIT(PAGING_PTE_SWPOFF_HIBIT - PAGING_PTE_SWPOFF_LOBIT + 1)
+/* SWPCNT - swap-in counter of a page, kept across swap out (top of USRNUM) */
+#define PAGING_PTE_SWPCNT_LOBIT 26
+#define PAGING_PTE_SWPCNT_HIBIT 27
+#define PAGING_PTE_SWPCNT_MAX 3
 
 /* PTE */
 #define PAGING_PTE_USRNUM_MASK GENMASK(PAGING_PTE_USRNUM_HIBIT,PAGING_PTE_USRNUM_LOBIT)
 #define PAGING_PTE_FPN_MASK    GENMASK(PAGING_PTE_FPN_HIBIT,PAGING_PTE_FPN_LOBIT)
 #define PAGING_PTE_SWPTYP_MASK GENMASK(PAGING_PTE_SWPTYP_HIBIT,PAGING_PTE_SWPTYP_LOBIT)
 #define PAGING_PTE_SWPOFF_MASK GENMASK(PAGING_PTE_SWPOFF_HIBIT,PAGING_PTE_SWPOFF_LOBIT)
+#define PAGING_PTE_SWPCNT_MASK GENMASK(PAGING_PTE_SWPCNT_HIBIT,PAGING_PTE_SWPCNT_LOBIT)
 
 /* Extract PTE */
 #define PAGING_PTE_OFFST(pte) GETVAL(pte,PAGING_OFFST_MASK,PAGING_ADDR_OFFST_LOBIT)
 #define PAGING_PTE_PGN(pte)   GETVAL(pte,PAGING_PGN_MASK,PAGING_ADDR_PGN_LOBIT)
 #define PAGING_PTE_FPN(pte)   GETVAL(pte,PAGING_PTE_FPN_MASK,PAGING_PTE_FPN_LOBIT)
 #define PAGING_PTE_SWP(pte)   GETVAL(pte,PAGING_PTE_SWPOFF_MASK,PAGING_SWPFPN_OFFSET)
+#define PAGING_PTE_SWPTYP(pte) GETVAL(pte,PAGING_PTE_SWPTYP_MASK,PAGING_PTE_SWPTYP_LOBIT)
+#define PAGING_PTE_SWPCNT(pte) GETVAL(pte,PAGING_PTE_SWPCNT_MASK,PAGING_PTE_SWPCNT_LOBIT)
 
 /* OFFSET */
 #define PAGING_ADDR_OFFST_LOBIT 0
@@ -94,9 +105,9 @@
 #define PAGING_FPN(x)  GETVAL(x,PAGING_PTE_FPN_MASK,PAGING_PTE_FPN_LOBIT)
 
 /* Memory range operator */
-/* TODO implement the INCLUDE and OVERLAP checking mechanism */
-#define INCLUDE(x1,x2,y1,y2) (0)
-#define OVERLAP(x1,x2,y1,y2) (0)
+/* [x1,x2) lies within [y1,y2) / [x1,x2) and [y1,y2) share an address */
+#define INCLUDE(x1,x2,y1,y2) ((y1) <= (x1) && (x2) <= (y2))
+#define OVERLAP(x1,x2,y1,y2) ((x1) < (y2) && (y1) < (x2))
 
 /* VM region prototypes */
 struct vm_rg_struct * init_vm_rg(addr_t rg_start, addr_t rg_end);
@@ -127,8 +138,13 @@ int init_pte(addr_t *pte,
              addr_t swpoff); //swap offset
 int __alloc(struct pcb_t *caller, int vmaid, int rgid, addr_t size, addr_t *alloc_addr);
 int __free(struct pcb_t *caller, int vmaid, int rgid);
+int __realloc(struct pcb_t *caller, int rgid, addr_t size, addr_t *alloc_addr);
+int __memcpy_rg(struct pcb_t *caller, int srcrg, int dstrg, addr_t offset, addr_t size);
+int __memset_rg(struct pcb_t *caller, int rgid, addr_t offset, BYTE value, addr_t size);
 int __read(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE *data);
 int __write(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE value);
+int __read_n(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, int nbytes, uint64_t *data);
+int __write_n(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, int nbytes, uint64_t value);
 int init_mm(struct mm_struct *mm, struct pcb_t *caller);
 
 /* VM prototypes */
@@ -144,23 +160,99 @@ int pgwrite(
 		BYTE data, // Data to be wrttien into memory
 		uint32_t destination, // Index of destination register
 		addr_t offset);
+int pg_getval_n(struct mm_struct *mm, addr_t addr, int nbytes, uint64_t *data, struct pcb_t *caller);
+int pg_setval_n(struct mm_struct *mm, addr_t addr, int nbytes, uint64_t value, struct pcb_t *caller);
 /* Local VM prototypes */
 struct vm_rg_struct * get_symrg_byid(struct mm_struct* mm, int rgid);
+struct vm_rg_struct *get_symrg_slot(struct mm_struct *mm, int rgid);
 int validate_overlap_vm_area(struct pcb_t *caller, int vmaid, addr_t vmastart, addr_t vmaend);
 int get_free_vmrg_area(struct pcb_t *caller, int vmaid, int size, struct vm_rg_struct *newrg);
 int inc_vma_limit(struct pcb_t *caller, int vmaid, addr_t inc_sz);
+int vm_freerg_insert(struct vm_area_struct *vma, addr_t start, addr_t end);
+int vm_freerg_alloc(struct vm_area_struct *vma, addr_t size, addr_t *start);
+int vm_freerg_lookup(struct vm_area_struct *vma, addr_t addr, addr_t *start, addr_t *end);
+int vm_freerg_remove(struct vm_area_struct *vma, addr_t start, addr_t end);
+void vm_freerg_destroy(struct vm_area_struct *vma);
+int vm_slab_alloc(struct vm_area_struct *vma, addr_t size, addr_t *start);
+void vm_slab_add_page(struct vm_area_struct *vma, addr_t size, addr_t pg_start);
+int vm_slab_free(struct vm_area_struct *vma, addr_t start);
+addr_t vm_slab_objsz(struct vm_area_struct *vma, addr_t start);
+void vm_slab_destroy(struct vm_area_struct *vma);
 int find_victim_page(struct mm_struct *mm, int *retpgn, struct pcb_t **ret_owner);
 
 struct vm_area_struct *get_vma_by_num(struct mm_struct *mm, int vmaid);
+struct vm_area_struct *find_vma(struct mm_struct *mm, addr_t addr);
+struct vm_area_struct *create_vm_area(struct mm_struct *mm, int vmaid, addr_t start);
 int enlist_pgn_node(struct pgn_t **plist, int pgn, struct pcb_t *owner);
 
 /* MEM/PHY protypes */
+/* Host backing of a MEMPHY storage */
+#define MEMPHY_BACK_HEAP 0 /* calloc, zero pages from the host allocator */
+#define MEMPHY_BACK_ANON 1 /* anonymous mmap, zero pages on first touch */
+#define MEMPHY_BACK_FILE 2 /* shared mmap of a sparse host file */
+
+/* I/O scheduler of a swap device */
+#define IOSCHED_FCFS 0
+#define IOSCHED_SSTF 1
+#define IOSCHED_SCAN 2
+#define IOSCHED_CLOOK 3
+#define IOSCHED_DEADLINE 4
+#define IOSCHED_NR 5
+
 int MEMPHY_get_freefp(struct memphy_struct *mp, addr_t *fpn);
+int MEMPHY_get_freefp_range(struct memphy_struct *mp, int order, addr_t *fpn);
 int MEMPHY_put_freefp(struct memphy_struct *mp, addr_t fpn);
+int MEMPHY_nr_free(struct memphy_struct *mp);
 int MEMPHY_read(struct memphy_struct * mp, addr_t addr, BYTE *value);
 int MEMPHY_write(struct memphy_struct * mp, addr_t addr, BYTE data);
+int MEMPHY_read_wide(struct memphy_struct *mp, addr_t addr, int nbytes, uint64_t *value);
+int MEMPHY_write_wide(struct memphy_struct *mp, addr_t addr, int nbytes, uint64_t value);
+BYTE *MEMPHY_direct(struct memphy_struct *mp, addr_t addr, int nbytes);
+int MEMPHY_copy(struct memphy_struct *mp, addr_t dst, addr_t src, addr_t n);
+int MEMPHY_set(struct memphy_struct *mp, addr_t addr, BYTE value, addr_t n);
+int MEMPHY_read_frame(struct memphy_struct *mp, addr_t fpn, BYTE *buf);
+int MEMPHY_write_frame(struct memphy_struct *mp, addr_t fpn, BYTE *buf);
+int MEMPHY_copy_frame(struct memphy_struct *mpsrc, addr_t srcfpn,
+                      struct memphy_struct *mpdst, addr_t dstfpn);
 int MEMPHY_dump(struct memphy_struct * mp);
 int init_memphy(struct memphy_struct *mp, addr_t max_size, int randomflg);
+int init_memphy_backed(struct memphy_struct *mp, addr_t max_size, int randomflg,
+                       int backing, const char *path);
+int release_memphy(struct memphy_struct *mp);
+int MEMPHY_numa_init(struct memphy_struct *mp, int nnodes, int ncpu,
+                     unsigned long remote_cost);
+void MEMPHY_numa_stats(struct memphy_struct *mp, const char *name);
+int MEMPHY_buddy_init(struct memphy_struct *mp, int maxorder);
+int MEMPHY_mag_init(struct memphy_struct *mp, int ncpu);
+void MEMPHY_set_cpu(int cpu);
+double MEMPHY_frag_index(struct memphy_struct *mp, int order);
+void MEMPHY_print_stats(struct memphy_struct *mp, const char *name);
+void MEMPHY_set_cost(struct memphy_struct *mp, unsigned long seek,
+                     unsigned long rot, unsigned long xfer);
+unsigned long MEMPHY_take_io_time(void);
+
+/* Swap management prototypes */
+/* pg_getpage() result: the page is being swapped in by the I/O worker */
+#define PAGING_SWAP_PENDING (-2000)
+
+int swap_get_slot(struct krnl_t *krnl, int *swptyp, addr_t *swpoff);
+int swap_put_slot(struct krnl_t *krnl, int swptyp, addr_t swpoff);
+void swap_set_owner(int swptyp, addr_t swpoff, struct pcb_t *owner, addr_t pgn);
+int swap_init(struct krnl_t *krnl);
+int swap_in_page(struct pcb_t *caller, addr_t pgn, uint32_t pte, addr_t fpn, int ra);
+int swap_out_page(struct krnl_t *krnl, addr_t *retfpn);
+int kswapd_start(struct krnl_t *krnl, int lowpct, int highpct);
+void kswapd_wakeup(struct krnl_t *krnl);
+void kswapd_stop(void);
+int swap_readahead(struct pcb_t *caller, addr_t pgn);
+void swap_readahead_hit(struct pcb_t *caller, addr_t pgn, uint32_t pte);
+void swap_set_readahead(int ramax);
+void swap_print_stats(struct krnl_t *krnl);
+int swap_io_start(struct krnl_t *krnl);
+int swap_io_async(void);
+void swap_io_submit(struct pcb_t *proc);
+void swap_io_stop(void);
+int swap_iosched_id(const char *name);
 
 /* print list */
 int print_list_fp(struct framephy_struct *fp);
@@ -21,6 +21,79 @@
 #define IODUMP 1
 #define PAGETBL_DUMP 1
 
+/*
+ * Background page-out daemon (kswapd): it is woken when the number of
+ * free MEMRAM frames drops below the LOW watermark and swaps pages out
+ * until the HIGH watermark is reached. Watermarks are percentages of the
+ * MEMRAM frames, the config directive "kswapd <low> <high>" overrides them.
+ */
+#define MM_KSWAPD 1
+#define KSWAPD_WMARK_LOW 5
+#define KSWAPD_WMARK_HIGH 10
+
+/*
+ * Swap-in readahead: on a swap-in fault the following swapped-out pages
+ * of the same process are brought in too. The window adapts between 1 and
+ * SWAP_RA_MAX pages depending on how many readahead pages get used, the
+ * config directive "readahead <max>" overrides it (0 disables readahead).
+ */
+#define SWAP_RA_MAX 8
+
+/*
+ * Tiered swap: the config directive "swap <id> <nvme|ssd|hdd> <prio>" puts
+ * a swap device in a speed class. Evictions go to the fastest device with
+ * free space; every SWAP_DEMOTE_MS kswapd moves up to SWAP_DEMOTE_BATCH
+ * cold pages off a fast device filled above SWAP_TIER_FULL percent. Pages
+ * swapped in repeatedly are hot and stay on the fast device.
+ */
+#define SWAP_DEMOTE_MS 20
+#define SWAP_DEMOTE_BATCH 4
+#define SWAP_TIER_FULL 50
+
+/*
+ * Asynchronous swap-in: a fault on a swapped-out page blocks the process
+ * and hands the swap-in to an I/O worker thread, the CPU dispatches
+ * another process meanwhile. Comment out to swap in on the faulting CPU.
+ */
+#define MM_SWAP_ASYNC 1
+
+/*
+ * MEMRAM frames are managed by a buddy allocator serving contiguous runs
+ * of up to 2^BUDDY_MAX_ORDER frames.
+ */
+#define BUDDY_MAX_ORDER 10
+
+/*
+ * NUMA: the directive "numa <nodes> <remote_cost>" splits MEMRAM into
+ * nodes and spreads the CPUs over them. A frame is taken from the node
+ * of the faulting CPU first, a CPU access to its own node costs
+ * NUMA_LOCAL_COST and one to another node <remote_cost>.
+ */
+#define NUMA_LOCAL_COST 100
+
+/*
+ * Sequential swap devices ("seqdev <swpN> <seek> <rot> <xfer>") charge
+ * every access with seek, rotation and transfer time. A time slot lasts
+ * SEQDEV_SLOT_TIME units of device time, an asynchronous swap-in keeps
+ * the process blocked for the slots its device time covers.
+ */
+#define SEQDEV_SLOT_TIME 1000
+
+/*
+ * Queued swap-ins of a device are ordered by its I/O scheduler, chosen by
+ * "iosched <swpN> <fcfs|sstf|scan|clook|deadline>" (default fcfs). The
+ * deadline policy serves a request first once it waited IOSCHED_EXPIRE
+ * units of device time.
+ */
+#define IOSCHED_EXPIRE 5000
+
+/*
+ * Translated memory accesses read and write the MEMRAM frame in place once
+ * pg_getpage has validated it, like a vDSO call. Comment out to route every
+ * access through the memmap syscall (for accounting).
+ */
+#define MM_MEMIO_DIRECT 1
+
 /* 
  * @bksysnet:
  *    The address mode must be explicitly define in MM64 or no-MM64
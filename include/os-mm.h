@@ -16,7 +16,8 @@
 
 #define MM_PAGING
 #define PAGING_MAX_MMSWP 4 /* max number of supported swapped space */
-#define PAGING_MAX_SYMTBL_SZ 30
+#define PAGING_SYMTBL_INIT_SZ 32 /* initial slots of the region table */
+#define PAGING_MAX_SYMTBL_SZ (1 << 16) /* bound of region IDs */
 
 /* * Forward declaration for PCB to avoid circular dependency 
  * (Khai báo trước cấu trúc pcb_t để dùng trong pgn_t)
@@ -69,6 +70,49 @@ struct vm_rg_struct {
 
 };
 
+/*
+ * Free region of a vm area, node of the address ordered treap and of
+ * its size class bin (see mm-vm.c)
+ */
+#define FREERG_NR_BINS 8
+#define FREERG_LARGE 4096 /* regions from this size live in the treap only */
+
+struct vm_freerg_struct {
+   addr_t rg_start;
+   addr_t rg_end;
+   addr_t max_size; /* largest region of the subtree */
+   unsigned int prio;
+
+   struct vm_freerg_struct *left, *right;
+   int bin;
+   struct vm_freerg_struct *bin_prev, *bin_next;
+};
+
+/*
+ * Slab of small regions carved out of one heap page (see mm-vm.c)
+ */
+#define SLAB_MIN_SHIFT 4 /* smallest object class is 16 bytes */
+#define SLAB_NR_CLASSES 7 /* 16 .. 1024 bytes */
+#define SLAB_MAX_OBJ (1 << (SLAB_MIN_SHIFT + SLAB_NR_CLASSES - 1))
+#define SLAB_MAP_WORDS (4096 >> SLAB_MIN_SHIFT >> 6) /* one bit per object */
+
+struct slab_struct {
+   addr_t pg_start;
+   int nr_free;
+   uint64_t map[SLAB_MAP_WORDS]; /* set bit: object in use */
+
+   struct slab_struct *next;
+};
+
+/*
+ * Areas of a process address space, each grows up from its base
+ */
+#define VMA_HEAP 0
+#define VMA_MMAP 1
+#define VMA_STACK 2
+#define VMA_MMAP_BASE ((addr_t)1 << 30)
+#define VMA_STACK_BASE ((addr_t)1 << 31)
+
 /*
  * Memory area struct
  */
@@ -83,7 +127,9 @@ struct vm_area_struct {
  * unsigned long vm_limit = vm_end - vm_start
  */
    struct mm_struct *vm_mm;
-   struct vm_rg_struct *vm_freerg_list;
+   struct vm_freerg_struct *vm_freerg_root;
+   struct vm_freerg_struct *vm_freerg_bin[FREERG_NR_BINS];
+   struct slab_struct *vm_slab[SLAB_NR_CLASSES];
    struct vm_area_struct *vm_next;
    pthread_mutex_t mm_lock;
 
@@ -107,12 +153,25 @@ struct mm_struct {
 #endif
 
    struct vm_area_struct *mmap;
+   /* Areas sorted by vm_start, they never overlap */
+   struct vm_area_struct **vma_idx;
+   int nr_vma;
 
-   /* Currently we support a fixed number of symbol */
-   struct vm_rg_struct symrgtbl[PAGING_MAX_SYMTBL_SZ];
+   /* Region table indexed by region ID, grown on demand */
+   struct vm_rg_struct *symrgtbl;
+   int symrgtbl_sz;
 
    /* list of free page */
    struct pgn_t *fifo_pgn;
+
+   /* Swap-in readahead state: current window, size of the last
+    * readahead batch and how many of its pages got accessed */
+   int ra_window;
+   int ra_size;
+   int ra_hit;
+
+   /* Page of the swap-in fault handed to the swap I/O worker */
+   int swapio_pgn;
    pthread_mutex_t mm_lock;
 
 };
@@ -130,18 +189,88 @@ struct framephy_struct {
 
 };
 
+/* NUMA node: a contiguous range of frames and the CPU accesses to it */
+struct memphy_node {
+   addr_t start_fp;
+   addr_t nr_fp;
+   unsigned long nr_local;
+   unsigned long nr_remote;
+   unsigned long nr_fallback; /* allocations served by another node */
+};
+
+/* Per CPU cache of free frames */
+#define MEMPHY_MAG_SIZE 16
+struct memphy_mag {
+   int busy; /* claimed by an atomic exchange, by its CPU or a thief */
+   int count;
+   addr_t fpn[MEMPHY_MAG_SIZE];
+};
+
 struct memphy_struct {
    /* Basic field of data and size */
    BYTE *storage;
-   int maxsz;
+   addr_t maxsz;
+
+   /* Host backing of storage (MEMPHY_BACK_*), fd of the file backing */
+   int backing;
+   int fd;
    
    /* Sequential device fields */ 
    int rdmflg;
-   int cursor;
+   addr_t cursor;
 
-   /* Management structure */
-   struct framephy_struct *free_fp_list;
+   /* Sequential device cost model (see MEMPHY_set_cost) and the device
+    * time, head travel in bytes, head moves and accesses so far */
+   unsigned long seek_cost;
+   unsigned long rot_cost;
+   unsigned long xfer_cost;
+   unsigned long io_time;
+   unsigned long seek_dist;
+   unsigned long nr_seek;
+   unsigned long nr_io;
+
+   /* Management structure: one bit per frame, set when the frame is
+    * in use, and the word where the last allocation was found (next-fit) */
+   uint64_t *fp_bitmap;
+   int fp_nwords;
+   int fp_cursor;
    struct framephy_struct *used_fp_list;
+   int free_fp_cnt;
+
+   /* NUMA nodes (1 when disabled): CPU c is on node
+    * c * nr_nodes / numa_ncpu, numa_rr interleaves kernel allocations */
+   int nr_nodes;
+   int numa_ncpu;
+   int numa_rr;
+   unsigned long numa_remote_cost;
+   unsigned long numa_time;
+   struct memphy_node *nodes;
+
+   /* Buddy allocator (0 orders when disabled): free block lists per
+    * node and order linked through frame numbers, and per frame the order of the
+    * free block it heads plus one (0 when it is not a free block head) */
+   int buddy_norder;
+   int *buddy_head;
+   int *buddy_next;
+   int *buddy_prev;
+   signed char *buddy_blk;
+
+   /* Per CPU magazines of free frames (nr_mags is 0 when disabled), a
+    * frame they hold stays marked in use in fp_bitmap and is flagged in
+    * fp_cached; mag_cached counts them */
+   struct memphy_mag *mags;
+   int nr_mags;
+   int mag_size;
+   unsigned char *fp_cached;
+   int mag_cached;
+
+   /* Swap tier: speed class (0 fastest) and priority inside the class */
+   int swp_class;
+   int swp_prio;
+
+   /* I/O scheduler (IOSCHED_*) ordering the queued swap-ins */
+   int iosched;
+
    pthread_mutex_t memphy_lock;
    pthread_mutex_t mm_lock;
 
@@ -23,6 +23,14 @@ void put_proc(struct pcb_t * proc);
 /* Add a new process to ready queue */
 void add_proc(struct pcb_t * proc);
 
+/* Drop a finished process from the running list and PID table */
+void exit_proc(struct pcb_t * proc);
+
+/* Park a process waiting for I/O, wake it back into the ready queue */
+void block_proc(struct pcb_t * proc);
+void wake_proc(struct pcb_t * proc);
+int blocked_procs(void);
+
 #endif
 
 
@@ -31,6 +31,30 @@ struct sc_regs {
 };
 
 
+/*
+ * Syscall ring shared by a process and the kernel, modeled on io_uring.
+ * The process queues sc_regs at sq_tail (orig_ax holds the syscall
+ * number) and enters the kernel once through the scring syscall, which
+ * consumes up to sq_tail and posts one completion per entry. Results such
+ * as the a3 of SYSMEM_IO_READ are written back into the queued entry, so
+ * a slot is reused only after its completion is reaped.
+ */
+#define SC_RING_SZ 64 /* power of two */
+
+struct sc_cqe {
+        uint32_t idx;   /* slot of the completed entry */
+        int32_t ret;    /* return value of the syscall */
+};
+
+struct sc_ring {
+        struct sc_regs sqe[SC_RING_SZ];
+        struct sc_cqe cqe[SC_RING_SZ];
+        uint32_t sq_head;       /* consumed by the kernel */
+        uint32_t sq_tail;       /* produced by the process */
+        uint32_t cq_head;       /* consumed by the process */
+        uint32_t cq_tail;       /* produced by the kernel */
+};
+
 /* This is used purely for kernel trace the table of system call */
 extern const char* sys_call_table[];
 extern const int syscall_table_size;
@@ -38,6 +62,12 @@ extern const int syscall_table_size;
 /* libsyscall interface */
 int __mm_swap_page(struct pcb_t *, addr_t , addr_t);
 int libsyscall(struct pcb_t*, uint32_t, arg_t, arg_t, arg_t);
+int libsyscall_submit(struct pcb_t*, uint32_t, arg_t, arg_t, arg_t, arg_t);
+int libsyscall_enter(struct pcb_t*);
+int libsyscall_reap(struct pcb_t*, struct sc_regs*, int*);
+int libsyscall_flush(struct pcb_t*);
 int syscall(struct krnl_t*, uint32_t, uint32_t, struct sc_regs*);
 int __sys_ni_syscall(struct krnl_t*, struct sc_regs*);
+struct pcb_t *get_caller(struct krnl_t*, uint32_t);
+int memmap_op(struct pcb_t*, struct sc_regs*);
 
@@ -58,6 +58,51 @@ int write(
 	return write_mem(proc->regs[destination] + offset, proc, data);
 }
 
+/* Access width in bytes of a multi-byte load or store */
+static int ins_width(enum ins_opcode_t opcode)
+{
+	switch (opcode)
+	{
+	case READ16:
+	case WRITE16:
+		return 2;
+	case READ32:
+	case WRITE32:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
+int read_n(struct pcb_t *proc, uint32_t source, uint32_t offset,
+	   uint32_t destination, int nbytes)
+{
+	BYTE data;
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < nbytes; i++)
+	{
+		if (!read_mem(proc->regs[source] + offset + i, proc, &data))
+			return 1;
+		value |= (uint64_t)(unsigned char)data << (8 * i);
+	}
+	proc->regs[destination] = value;
+	return 0;
+}
+
+int write_n(struct pcb_t *proc, uint64_t data, uint32_t destination,
+	    uint32_t offset, int nbytes)
+{
+	int i;
+
+	for (i = 0; i < nbytes; i++)
+		if (write_mem(proc->regs[destination] + offset + i, proc,
+			      (BYTE)(data >> (8 * i))))
+			return 1;
+	return 0;
+}
+
 int run(struct pcb_t *proc)
 {
 	/* Check if Program Counter point to the proper instruction */
@@ -69,6 +114,9 @@ int run(struct pcb_t *proc)
 	struct inst_t ins = proc->code->text[proc->pc];
 	proc->pc++;
 	int stat = 1;
+#ifdef MM_PAGING
+	uint64_t wide;
+#endif
 switch (ins.opcode)
 	{
 	case CALC:
@@ -76,9 +124,30 @@ switch (ins.opcode)
 		break;
 	case ALLOC:
 #ifdef MM_PAGING
-		stat = liballoc(proc, ins.arg_0, ins.arg_1);
+		stat = liballoc(proc, ins.arg_2, ins.arg_0, ins.arg_1);
 #else
 		stat = alloc(proc, ins.arg_0, ins.arg_1);
+#endif
+		break;
+	case REALLOC:
+#ifdef MM_PAGING
+		stat = librealloc(proc, ins.arg_0, ins.arg_1);
+#else
+		stat = 1; /* needs the paging memory manager */
+#endif
+		break;
+	case MEMCPY:
+#ifdef MM_PAGING
+		stat = libmemcpy(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins.arg_3);
+#else
+		stat = 1;
+#endif
+		break;
+	case MEMSET:
+#ifdef MM_PAGING
+		stat = libmemset(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins.arg_3);
+#else
+		stat = 1;
 #endif
 		break;
 	case FREE:
@@ -100,13 +169,46 @@ switch (ins.opcode)
 		stat = libwrite(proc, ins.arg_0, ins.arg_1, ins.arg_2);
 #else
 		stat = write(proc, ins.arg_0, ins.arg_1, ins.arg_2);
+#endif
+		break;
+	case READ16:
+	case READ32:
+	case READ64:
+#ifdef MM_PAGING
+		stat = libread_n(proc, ins.arg_0, ins.arg_1, ins_width(ins.opcode), &wide);
+#else
+		stat = read_n(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins_width(ins.opcode));
+#endif
+		break;
+	case WRITE16:
+	case WRITE32:
+	case WRITE64:
+#ifdef MM_PAGING
+		stat = libwrite_n(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins_width(ins.opcode));
+#else
+		stat = write_n(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins_width(ins.opcode));
 #endif
 		break;
 	case SYSCALL:
 		stat = libsyscall(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins.arg_3);
 		break;
+	case SUBMIT:
+		/* A full ring is flushed to make room, the entry is never dropped */
+		if (libsyscall_submit(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins.arg_3, 0) < 0 &&
+		    (libsyscall_flush(proc) < 0 ||
+		     libsyscall_submit(proc, ins.arg_0, ins.arg_1, ins.arg_2, ins.arg_3, 0) < 0))
+			stat = 1;
+		break;
+	case ENTER:
+		stat = libsyscall_flush(proc) < 0;
+		break;
 	default:
 		stat = 1;
 	}
+#ifdef MM_PAGING
+	/* Blocked on swap-in, the instruction is restarted once woken up */
+	if (stat == PAGING_SWAP_PENDING)
+		proc->pc--;
+#endif
 	return stat;
 }
@@ -123,44 +123,115 @@ void tlb_cache_write(int pid, int pgn, int fpn) {
 /* HELPER FUNCTIONS                                                          */
 /* ========================================================================= */
 
-/*enlist_vm_freerg_list - add new rg to freerg_list */
+/*enlist_vm_freerg_list - give rg back to the free regions of the first vma */
 int enlist_vm_freerg_list(struct mm_struct *mm, struct vm_rg_struct *rg_elmt)
 {
-  struct vm_rg_struct *rg_node = mm->mmap->vm_freerg_list;
-
-  if (rg_elmt->rg_start >= rg_elmt->rg_end)
+  if (vm_freerg_insert(mm->mmap, rg_elmt->rg_start, rg_elmt->rg_end) < 0)
     return -1;
 
-  if (rg_node != NULL)
-    rg_elmt->rg_next = rg_node;
-
-  mm->mmap->vm_freerg_list = rg_elmt;
-
+  free(rg_elmt);
   return 0;
 }
 
 /*get_symrg_byid - get mem region by region ID */
 struct vm_rg_struct *get_symrg_byid(struct mm_struct *mm, int rgid)
 {
-  if (rgid < 0 || rgid > PAGING_MAX_SYMTBL_SZ)
+  if (rgid < 0 || rgid >= mm->symrgtbl_sz)
     return NULL;
   return &mm->symrgtbl[rgid];
 }
 
+/*
+ * get_symrg_slot - get the slot of region ID @rgid to record a new region
+ * The table doubles until it holds @rgid, new slots are empty regions.
+ */
+struct vm_rg_struct *get_symrg_slot(struct mm_struct *mm, int rgid)
+{
+  struct vm_rg_struct *tbl;
+  int sz = mm->symrgtbl_sz;
+
+  if (rgid < 0 || rgid >= PAGING_MAX_SYMTBL_SZ)
+    return NULL;
+  if (rgid < sz)
+    return &mm->symrgtbl[rgid];
+
+  while (sz <= rgid)
+    sz *= 2;
+  tbl = realloc(mm->symrgtbl, sz * sizeof(struct vm_rg_struct));
+  if (tbl == NULL)
+    return NULL;
+  memset(tbl + mm->symrgtbl_sz, 0,
+         (sz - mm->symrgtbl_sz) * sizeof(struct vm_rg_struct));
+  mm->symrgtbl = tbl;
+  mm->symrgtbl_sz = sz;
+  return &tbl[rgid];
+}
+
 /* ========================================================================= */
 /* MEMORY ALLOCATION                                                         */
 /* ========================================================================= */
 
+/*expand_heap - grow a vm area by inc_sz bytes from its sbrk, kept in old_sbrk */
+static int expand_heap(struct pcb_t *caller, int vmaid,
+                       struct vm_area_struct *cur_vma, addr_t inc_sz, addr_t *old_sbrk)
+{
+  *old_sbrk = cur_vma->sbrk;
+
+  // System call to kernel for physical frame allocation
+  struct sc_regs regs;
+  regs.a1 = SYSMEM_INC_OP;
+  regs.a2 = vmaid;
+  regs.a3 = inc_sz;
+  if (syscall(caller->krnl, caller->pid, 17, &regs) < 0) {
+    printf("[ERROR] PID %d: area %d cannot grow by %ld bytes\n",
+           caller->pid, vmaid, inc_sz);
+    return -1;
+  }
+
+  // CRITICAL: Update sbrk pointer
+  cur_vma->sbrk += inc_sz;
+  return 0;
+}
+
 /*__alloc - allocate a region memory */
 int __alloc(struct pcb_t *caller, int vmaid, int rgid, addr_t size, addr_t *alloc_addr)
 {
   pthread_mutex_lock(&caller->krnl-> mm->mm_lock);
   struct vm_rg_struct rgnode;
+  addr_t old_sbrk;
+  struct vm_rg_struct *symrg = get_symrg_slot(caller->mm, rgid);
+  struct vm_area_struct *cur_vma = get_vma_by_num(caller->mm, vmaid);
+
+  if (symrg == NULL || cur_vma == NULL) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
 //print_fifo_status(caller->krnl->mm);
-  // Strategy 1: Try to reuse freed regions (Best-Fit)
+  // Strategy 0: Small regions share pages of the slab caches
+  if (size > 0 && size <= SLAB_MAX_OBJ) {
+    if (vm_slab_alloc(cur_vma, size, alloc_addr) < 0) {
+      if (expand_heap(caller, vmaid, cur_vma, PAGING_PAGESZ, &old_sbrk) < 0) {
+        pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+        return -1;
+      }
+      vm_slab_add_page(cur_vma, size, old_sbrk);
+      vm_slab_alloc(cur_vma, size, alloc_addr);
+    }
+    symrg->rg_start = *alloc_addr;
+    symrg->rg_end = *alloc_addr + size;
+
+    printf("=========> MEMORY ALLOCATION (SLAB) <=========\n");
+    printf("PID: %d | Region: %d | Size: %ld | Address: %ld\n",
+           caller->pid, vmaid, size, *alloc_addr);
+
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return 0;
+  }
+
+  // Strategy 1: Try to reuse freed regions
   if (get_free_vmrg_area(caller, vmaid, size, &rgnode) == 0) {
-    caller->mm->symrgtbl[rgid].rg_start = rgnode.rg_start;
-    caller->mm->symrgtbl[rgid].rg_end = rgnode.rg_end;
+    symrg->rg_start = rgnode.rg_start;
+    symrg->rg_end = rgnode.rg_end;
     *alloc_addr = rgnode.rg_start;
     
     printf("=========> MEMORY ALLOCATION (REUSE) <=========\n");
@@ -171,26 +242,18 @@ int __alloc(struct pcb_t *caller, int vmaid, int rgid, addr_t size, addr_t *allo
     return 0;
   }
 
-  // Strategy 2: Expand heap (sbrk)
-  struct vm_area_struct *cur_vma = get_vma_by_num(caller->mm, vmaid);
-  
-  int inc_sz = PAGING_PAGE_ALIGNSZ(size);  // Round up to page size
-  int old_sbrk = cur_vma->sbrk;
-  
-  // System call to kernel for physical frame allocation
-  struct sc_regs regs;
-  regs.a1 = SYSMEM_INC_OP;
-  regs.a2 = vmaid;
-  regs.a3 = inc_sz;
-  syscall(caller->krnl, caller->pid, 17, &regs);
+  // Strategy 2: Expand heap (sbrk), rounded up to page size
+  if (expand_heap(caller, vmaid, cur_vma, PAGING_PAGE_ALIGNSZ(size), &old_sbrk) < 0) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
 
-  // Update symbol table
-  caller->mm->symrgtbl[rgid].rg_start = old_sbrk;
-  caller->mm->symrgtbl[rgid].rg_end = old_sbrk + size;
+  // Update symbol table, the rest of the last page stays free
+  symrg->rg_start = old_sbrk;
+  symrg->rg_end = old_sbrk + size;
   *alloc_addr = old_sbrk;
-  // CRITICAL: Update sbrk pointer
-  cur_vma->sbrk += inc_sz;
-  
+  vm_freerg_insert(cur_vma, old_sbrk + size, cur_vma->sbrk);
+
   printf("=========> MEMORY ALLOCATION (EXPAND) <=========\n");
   printf("PID: %d | Region: %d | Size: %ld | Address: %ld\n", 
          caller->pid, vmaid, size, *alloc_addr);
@@ -203,49 +266,24 @@ int __alloc(struct pcb_t *caller, int vmaid, int rgid, addr_t size, addr_t *allo
 /* MEMORY DEALLOCATION                                                       */
 /* ========================================================================= */
 
-/*__free - remove a region memory */
-int __free(struct pcb_t *caller, int vmaid, int rgid) 
+/*release_pages - unmap pages [pgn_start, pgn_end), freeing their frames and swap slots */
+static void release_pages(struct pcb_t *caller, addr_t pgn_start, addr_t pgn_end)
 {
-  if (!caller || !caller->mm) return -1;
-  struct mm_struct *mm = caller->mm;
-  
-  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+  struct pgn_t **pp, *pg;
 
-  if (rgid < 0 || rgid > PAGING_MAX_SYMTBL_SZ) {
-    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
-    return -1;
-  }
-
-  struct vm_rg_struct *rgnode = get_symrg_byid(mm, rgid);
-  
-  if (rgnode == NULL || (rgnode->rg_start == 0 && rgnode->rg_end == 0)) {
-    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
-    return -1;
-  }
-  
-  // Calculate number of pages
-  int size = rgnode->rg_end - rgnode->rg_start;
-  int num_pages = (size + PAGING_PAGESZ - 1) / PAGING_PAGESZ;
-  int pgn_start = (uint64_t)rgnode->rg_start >> PAGING_ADDR_PGN_LOBIT;
-
-  pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
-  
-  // Free physical resources
-  for (int i = 0; i < num_pages; i++) {
-    int pgn = pgn_start + i;
+  for (addr_t pgn = pgn_start; pgn < pgn_end; pgn++) {
     uint32_t pte = pte_get_entry(caller, pgn);
     
     if (PAGING_PAGE_PRESENT(pte)) {
       // Page in RAM
-      int fpn = PAGING_FPN(pte);
-      MEMPHY_put_freefp(caller->krnl->mram, fpn);
+      MEMPHY_put_freefp(caller->krnl->mram, PAGING_FPN(pte));
     } 
-    else if (PAGING_PTE_SWP(pte)) {
-      // Page in SWAP
-      addr_t swpfpn = PAGING_SWP(pte);
-      if (swpfpn != 0) {
-        MEMPHY_put_freefp(caller->krnl->active_mswp, swpfpn);
-      }
+    else if (pte & PAGING_PTE_SWAPPED_MASK) {
+      // Page in SWAP, slot is on the device recorded in SWPTYP
+      swap_put_slot(caller->krnl, PAGING_PTE_SWPTYP(pte), PAGING_SWP(pte));
+    }
+    else if (pte == 0) {
+      continue;
     }
 
     // Clear PTE
@@ -255,19 +293,88 @@ int __free(struct pcb_t *caller, int vmaid, int rgid)
     tlb_clear_entry(caller->pid, pgn);
   }
 
+  // Drop the FIFO nodes too, a later remap of the range enlists them again
+  pp = &caller->krnl->mm->fifo_pgn;
+  while (*pp != NULL) {
+    pg = *pp;
+    if (pg->owner == caller && pg->pgn >= pgn_start && pg->pgn < pgn_end) {
+      *pp = pg->pg_next;
+      free(pg);
+    } else {
+      pp = &pg->pg_next;
+    }
+  }
+}
+
+/*trim_heap - lower the sbrk of an area whose free space reaches it to new_sbrk */
+static void trim_heap(struct pcb_t *caller, struct vm_area_struct *vma, addr_t new_sbrk)
+{
+  vm_freerg_remove(vma, new_sbrk, vma->sbrk);
+  release_pages(caller, PAGING64_PGN(new_sbrk), PAGING64_PGN(vma->sbrk));
+
+  printf("=========> HEAP TRIM <=========\n");
+  printf("PID: %d | Region: %ld | sbrk: %ld -> %ld\n",
+         caller->pid, vma->vm_id, vma->sbrk, new_sbrk);
+
+  vma->sbrk = new_sbrk;
+  vma->vm_end = new_sbrk;
+}
+
+/*give_back - return [start, end) of an area to its free regions
+ * The range is merged with its free neighbours, the pages left wholly
+ * free are unmapped (the edge pages may be shared) and free space
+ * reaching sbrk lowers it.
+ */
+static void give_back(struct pcb_t *caller, struct vm_area_struct *vma,
+                      addr_t start, addr_t end)
+{
+  addr_t fs, fe, lo, hi;
+
+  if (vm_freerg_insert(vma, start, end) < 0)
+    return;
+  vm_freerg_lookup(vma, start, &fs, &fe);
+
+  lo = PAGING_PAGE_ALIGNSZ(fs);
+  if (lo < start)
+    lo = start & ~((addr_t)PAGING_PAGESZ - 1);
+  hi = fe & ~((addr_t)PAGING_PAGESZ - 1);
+  if (hi > PAGING_PAGE_ALIGNSZ(end))
+    hi = PAGING_PAGE_ALIGNSZ(end);
+  if (lo < hi)
+    release_pages(caller, PAGING64_PGN(lo), PAGING64_PGN(hi));
+
+  if (fe == vma->sbrk && PAGING_PAGE_ALIGNSZ(fs) < fe)
+    trim_heap(caller, vma, PAGING_PAGE_ALIGNSZ(fs));
+}
+
+/*__free - remove a region memory, its area is found from the region address */
+int __free(struct pcb_t *caller, int vmaid, int rgid) 
+{
+  if (!caller || !caller->mm) return -1;
+  struct mm_struct *mm = caller->mm;
+  
   pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+
+  struct vm_rg_struct *rgnode = get_symrg_byid(mm, rgid);
   
-  // Add to free list for reuse
-  struct vm_area_struct *cur_vma = get_vma_by_num(mm, vmaid);
-  if (cur_vma != NULL) {
-    struct vm_rg_struct *freerg_node = malloc(sizeof(struct vm_rg_struct));
-    freerg_node->rg_start = rgnode->rg_start;
-    freerg_node->rg_end = rgnode->rg_end;
-    
-    freerg_node->rg_next = cur_vma->vm_freerg_list;
-    cur_vma->vm_freerg_list = freerg_node;
+  if (rgnode == NULL || (rgnode->rg_start == 0 && rgnode->rg_end == 0)) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
   }
 
+  // Slab objects only go back to their cache, the page stays in use
+  struct vm_area_struct *cur_vma = find_vma(mm, rgnode->rg_start);
+  if (cur_vma != NULL && vm_slab_objsz(cur_vma, rgnode->rg_start) > 0) {
+    vm_slab_free(cur_vma, rgnode->rg_start);
+    rgnode->rg_start = 0;
+    rgnode->rg_end = 0;
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return 0;
+  }
+  
+  if (cur_vma != NULL)
+    give_back(caller, cur_vma, rgnode->rg_start, rgnode->rg_end);
+
   // Clear ownership info
   rgnode->rg_start = 0;
   rgnode->rg_end = 0;
@@ -284,6 +391,10 @@ int __free(struct pcb_t *caller, int vmaid, int rgid)
 /*
  * pg_getpage - Get page in RAM, perform swap in/out if needed
  * UPDATED: Checks TLB first
+ * With asynchronous swap-in, a fault on a swapped-out page returns
+ * PAGING_SWAP_PENDING and the caller gets blocked until the swap I/O
+ * worker has brought the page in. The retry of that same page is served
+ * synchronously so the process cannot starve.
  */
 int pg_getpage(struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
 {
@@ -300,6 +411,9 @@ int pg_getpage(struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
   // ========== CASE 1: PAGE HIT - Already in RAM ==========
   if (is_present && !is_swapped) {
     *fpn = PAGING_FPN(pte);
+
+    if (pte & PAGING_PTE_READAHEAD_MASK)
+      swap_readahead_hit(caller, pgn, pte);
     
     // [TLB ADDITION] Update TLB
     tlb_cache_write(caller->pid, pgn, *fpn);
@@ -310,84 +424,51 @@ int pg_getpage(struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
   addr_t new_fpn;
   addr_t swpfpn = 0;
   int need_swap_in = is_swapped;
+
+  if (need_swap_in && swap_io_async() && caller->mm->swapio_pgn != pgn) {
+    caller->mm->swapio_pgn = pgn;
+    return PAGING_SWAP_PENDING;
+  }
   
   if (need_swap_in) {
+    /* The deferred fault is served now, by the I/O worker or a retry */
+    if (caller->mm->swapio_pgn == pgn)
+      caller->mm->swapio_pgn = -1;
     printf("Page Fault Need Swap \n");
     swpfpn = PAGING_SWP(pte);  // Get swap location
   }
 
   // Try to allocate frame in RAM
-  int ram_result = MEMPHY_get_freefp(caller->krnl->mram, &new_fpn);
-  
-  if (ram_result == 0) {
-    // Got free frame from RAM
-  } 
-  else {
-    // ========== RAM FULL - Need to SWAP OUT victim ==========
-    int vicpgn;
-    struct pcb_t *vic_owner;
-    
-    // Find victim page from global FIFO queue
-    if (find_victim_page(caller->krnl->mm, &vicpgn, &vic_owner) < 0) {
+  if (MEMPHY_get_freefp(caller->krnl->mram, &new_fpn) != 0) {
+    // ========== RAM FULL - Direct reclaim, kswapd did not keep up ==========
+    if (swap_out_page(caller->krnl, &new_fpn) < 0) {
       printf("[ERROR] Cannot find victim page for swapping\n");
       return -1;
     }
-    
-    printf("[SWAP OUT] PID %d needs frame. Victim: PID %d, PGN %d\n", 
-           caller->pid, vic_owner->pid, vicpgn);
-    
-    // Get victim's PTE and frame number
-    uint32_t vicpte = pte_get_entry(vic_owner, vicpgn);
-    
-    if (!(vicpte & PAGING_PTE_PRESENT_MASK)) {
-      printf("[ERROR] Victim page not present!\n");
-      return -1;
-    }
-    
-    int vicfpn = PAGING_FPN(vicpte);
-
-    // [TLB ADDITION] Xóa TLB của victim ngay lập tức vì frame sắp bị lấy mất
-    tlb_clear_entry(vic_owner->pid, vicpgn);
-
-    // Get free frame in SWAP device
-    addr_t victim_swpfpn;
-    if (MEMPHY_get_freefp(caller->krnl->active_mswp, &victim_swpfpn) < 0) {
-      printf("[ERROR] SWAP device is also full!\n");
-      return -1;
-    }
-
-    // Copy victim page: RAM -> SWAP
-    __swap_cp_page(caller->krnl->mram, vicfpn, 
-                   caller->krnl->active_mswp, victim_swpfpn);
-
-    printf("[SWAP OUT] Copied RAM[%d] -> SWAP[%ld]\n", vicfpn, victim_swpfpn);
-
-    // Update victim's PTE: mark as swapped
-    pte_set_swap(vic_owner, vicpgn, 0, victim_swpfpn);
-
-    // Reuse victim's frame
-    new_fpn = vicfpn;
   }
 
+  // Let kswapd refill the free frame pool ahead of the next fault
+  kswapd_wakeup(caller->krnl);
+
   // ========== SWAP IN: Copy from SWAP to RAM (if needed) ==========
-  if (need_swap_in && swpfpn != 0) {
-    printf("[SWAP IN] PID %d, PGN %d: SWAP[%ld] -> RAM[%ld]\n", 
-           caller->pid, pgn, swpfpn, new_fpn);
-    
-    // Copy data: SWAP -> RAM
-    __swap_cp_page(caller->krnl->active_mswp, swpfpn, 
-                   caller->krnl->mram, new_fpn);
+  if (need_swap_in) {
+    printf("[SWAP IN] PID %d, PGN %d: SWAP%d[%ld] -> RAM[%ld]\n", 
+           caller->pid, pgn, (int)PAGING_PTE_SWPTYP(pte), swpfpn, new_fpn);
     
-    // Free the swap frame
-    MEMPHY_put_freefp(caller->krnl->active_mswp, swpfpn);
+    // Copy data: SWAP -> RAM, free the swap slot and map the frame
+    swap_in_page(caller, pgn, pte, new_fpn, 0);
+  } else {
+    // ========== Update PTE: Mark page as present in RAM ==========
+    pte_set_fpn(caller, pgn, new_fpn);
   }
 
-  // ========== Update PTE: Mark page as present in RAM ==========
-  pte_set_fpn(caller, pgn, new_fpn);
-
   // Add to FIFO queue for future victim selection
   enlist_pgn_node(&caller->krnl->mm->fifo_pgn, pgn, caller);
 
+  // Sequential faults: bring the following swapped-out pages in as well
+  if (need_swap_in)
+    swap_readahead(caller, pgn);
+
   // [TLB ADDITION] Cập nhật TLB cho trang mới
   tlb_cache_write(caller->pid, pgn, new_fpn);
 
@@ -396,55 +477,168 @@ int pg_getpage(struct mm_struct *mm, int pgn, int *fpn, struct pcb_t *caller)
 }
 
 /*
- * pg_getval - Read a byte from virtual address
+ * pg_io_read / pg_io_write - Access @nbytes at MEMRAM address @phyaddr
+ * of a frame pg_getpage has validated. With MM_MEMIO_DIRECT the frame is
+ * accessed in place, otherwise through the memmap syscall.
  */
-int pg_getval(struct mm_struct *mm, int addr, BYTE *data, struct pcb_t *caller) 
+static void pg_io_read(struct pcb_t *caller, addr_t phyaddr, int nbytes, uint64_t *data)
 {
-  int pgn = PAGING64_PGN(addr);
-  int off = PAGING_OFFST(addr);
-  int fpn;
-  
-  // Ensure page is in RAM (may trigger swap)
-  if (pg_getpage(mm, pgn, &fpn, caller) != 0) 
-    return -1;
-  
-  // Calculate physical address
-  int phyaddr = (fpn << PAGING_ADDR_FPN_LOBIT) + off;
-  
-  // Read from physical memory via system call
+#ifdef MM_MEMIO_DIRECT
+  BYTE *p = MEMPHY_direct(caller->krnl->mram, phyaddr, nbytes);
+  int i;
+
+  if (p != NULL) {
+    *data = 0;
+    for (i = 0; i < nbytes; i++)
+      *data |= (uint64_t)(unsigned char)p[i] << (8 * i);
+    return;
+  }
+#endif
+
   struct sc_regs regs;
   regs.a1 = SYSMEM_IO_READ;
   regs.a2 = phyaddr;
   regs.a3 = 0;
+  regs.a4 = nbytes;
   syscall(caller->krnl, caller->pid, 17, &regs);
-  
-  *data = (BYTE)regs.a3;
+
+  *data = regs.a3;
+}
+
+static void pg_io_write(struct pcb_t *caller, addr_t phyaddr, int nbytes, uint64_t value)
+{
+#ifdef MM_MEMIO_DIRECT
+  BYTE *p = MEMPHY_direct(caller->krnl->mram, phyaddr, nbytes);
+  int i;
+
+  if (p != NULL) {
+    for (i = 0; i < nbytes; i++)
+      p[i] = (BYTE)(value >> (8 * i));
+    return;
+  }
+#endif
+
+  struct sc_regs regs;
+  regs.a1 = SYSMEM_IO_WRITE;
+  regs.a2 = phyaddr;
+  regs.a3 = value;
+  regs.a4 = nbytes;
+  syscall(caller->krnl, caller->pid, 17, &regs);
+}
+
+/*
+ * pg_io_copy / pg_io_set - Copy or fill @n bytes of MEMRAM frames, the
+ * range never crosses a frame boundary
+ */
+static void pg_io_copy(struct pcb_t *caller, addr_t dst, addr_t src, addr_t n)
+{
+#ifdef MM_MEMIO_DIRECT
+  BYTE *d = MEMPHY_direct(caller->krnl->mram, dst, n);
+  BYTE *s = MEMPHY_direct(caller->krnl->mram, src, n);
+
+  if (d != NULL && s != NULL) {
+    memmove(d, s, n);
+    return;
+  }
+#endif
+
+  struct sc_regs regs;
+  regs.a1 = SYSMEM_IO_COPY;
+  regs.a2 = dst;
+  regs.a3 = src;
+  regs.a4 = n;
+  syscall(caller->krnl, caller->pid, 17, &regs);
+}
+
+static void pg_io_set(struct pcb_t *caller, addr_t dst, BYTE value, addr_t n)
+{
+#ifdef MM_MEMIO_DIRECT
+  BYTE *d = MEMPHY_direct(caller->krnl->mram, dst, n);
+
+  if (d != NULL) {
+    memset(d, value, n);
+    return;
+  }
+#endif
+
+  struct sc_regs regs;
+  regs.a1 = SYSMEM_IO_SET;
+  regs.a2 = dst;
+  regs.a3 = (unsigned char)value;
+  regs.a4 = n;
+  syscall(caller->krnl, caller->pid, 17, &regs);
+}
+
+/*
+ * pg_getval - Read a byte from virtual address
+ */
+int pg_getval(struct mm_struct *mm, addr_t addr, BYTE *data, struct pcb_t *caller) 
+{
+  uint64_t value;
+  int ret = pg_getval_n(mm, addr, 1, &value, caller);
+
+  if (ret == 0)
+    *data = (BYTE)value;
+  return ret;
+}
+
+/*
+ * pg_getval_n - Read @nbytes (up to 8, little endian) from virtual address
+ * The address is translated once when the access fits in one page, an
+ * access across a page boundary falls back to one byte at a time.
+ */
+int pg_getval_n(struct mm_struct *mm, addr_t addr, int nbytes, uint64_t *data, struct pcb_t *caller)
+{
+  int pgn = PAGING64_PGN(addr);
+  int off = PAGING_OFFST(addr);
+  int fpn, ret, i;
+  BYTE byte;
+
+  if (off + nbytes > PAGING_PAGESZ) {
+    *data = 0;
+    for (i = 0; i < nbytes; i++) {
+      if ((ret = pg_getval(mm, addr + i, &byte, caller)) != 0)
+        return ret;
+      *data |= (uint64_t)(unsigned char)byte << (8 * i);
+    }
+    return 0;
+  }
+
+  if ((ret = pg_getpage(mm, pgn, &fpn, caller)) != 0)
+    return ret;
+
+  pg_io_read(caller, ((addr_t)fpn << PAGING_ADDR_FPN_LOBIT) + off, nbytes, data);
   return 0;
 }
 
 /*
  * pg_setval - Write a byte to virtual address
  */
-int pg_setval(struct mm_struct *mm, int addr, BYTE value, struct pcb_t *caller) 
+int pg_setval(struct mm_struct *mm, addr_t addr, BYTE value, struct pcb_t *caller) 
+{
+  return pg_setval_n(mm, addr, 1, (unsigned char)value, caller);
+}
+
+/*
+ * pg_setval_n - Write @nbytes (up to 8, little endian) to virtual address
+ */
+int pg_setval_n(struct mm_struct *mm, addr_t addr, int nbytes, uint64_t value, struct pcb_t *caller)
 {
   int pgn = PAGING64_PGN(addr);
   int off = PAGING_OFFST(addr);
-  int fpn;
+  int fpn, ret, i;
 
-  // Ensure page is in RAM (may trigger swap)
-  if (pg_getpage(mm, pgn, &fpn, caller) != 0) 
-    return -1;
-  
-  // Calculate physical address
-  int phyaddr = (fpn << PAGING_ADDR_FPN_LOBIT) + off;
-  
-  // Write to physical memory via system call
-  struct sc_regs regs;
-  regs.a1 = SYSMEM_IO_WRITE;
-  regs.a2 = phyaddr;
-  regs.a3 = (uint32_t)value;
-  syscall(caller->krnl, caller->pid, 17, &regs);
-  
+  if (off + nbytes > PAGING_PAGESZ) {
+    for (i = 0; i < nbytes; i++)
+      if ((ret = pg_setval(mm, addr + i, (BYTE)(value >> (8 * i)), caller)) != 0)
+        return ret;
+    return 0;
+  }
+
+  if ((ret = pg_getpage(mm, pgn, &fpn, caller)) != 0)
+    return ret;
+
+  pg_io_write(caller, ((addr_t)fpn << PAGING_ADDR_FPN_LOBIT) + off, nbytes, value);
   return 0;
 }
 
@@ -453,9 +647,22 @@ int pg_setval(struct mm_struct *mm, int addr, BYTE value, struct pcb_t *caller)
 /* ========================================================================= */
 
 /*
- * __read - Read from memory region
+ * __read - Read a byte from memory region
  */
 int __read(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE *data) 
+{
+  uint64_t value;
+  int ret = __read_n(caller, vmaid, rgid, offset, 1, &value);
+
+  if (ret == 0)
+    *data = (BYTE)value;
+  return ret;
+}
+
+/*
+ * __read_n - Read @nbytes from memory region
+ */
+int __read_n(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, int nbytes, uint64_t *data) 
 {
   struct mm_struct *mm = caller->mm;
   pthread_mutex_lock(&caller->krnl->mm->mm_lock);
@@ -468,21 +675,30 @@ int __read(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE *data)
     return -1;
   }
   
-  // Check bounds
-  if (currg->rg_start + offset >= currg->rg_end) {
+  // Check bounds, a huge offset must not wrap past the region
+  if (offset > currg->rg_end - currg->rg_start ||
+      (addr_t)nbytes > currg->rg_end - currg->rg_start - offset) {
     pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
     return -1;
   }
   
-  int ret = pg_getval(mm, currg->rg_start + offset, data, caller);
+  int ret = pg_getval_n(mm, currg->rg_start + offset, nbytes, data, caller);
   pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
   return ret;
 }
 
 /*
- * __write - Write to memory region
+ * __write - Write a byte to memory region
  */
 int __write(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE value) 
+{
+  return __write_n(caller, vmaid, rgid, offset, 1, (unsigned char)value);
+}
+
+/*
+ * __write_n - Write @nbytes to memory region
+ */
+int __write_n(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, int nbytes, uint64_t value) 
 {
   struct mm_struct *mm = caller->mm;
   pthread_mutex_lock(&caller->krnl->mm->mm_lock);
@@ -496,27 +712,341 @@ int __write(struct pcb_t *caller, int vmaid, int rgid, addr_t offset, BYTE value
     return -1;
   }
   
-  if (currg->rg_start + offset >= currg->rg_end) {
+  if (offset > currg->rg_end - currg->rg_start ||
+      (addr_t)nbytes > currg->rg_end - currg->rg_start - offset) {
     printf("[ERROR] Segmentation fault at register %d\n", rgid);
     pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
     return -1;
   }
   
-  pg_setval(mm, currg->rg_start + offset, value, caller);
+  int ret = pg_setval_n(mm, currg->rg_start + offset, nbytes, value, caller);
+  pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+  return ret;
+}
+
+/* ========================================================================= */
+/* MEMORY REALLOCATION                                                       */
+/* ========================================================================= */
+
+/*
+ * vm_phyaddr - MEMRAM address of virtual address @addr, faulting its page
+ * in. A swapped out page is brought in synchronously (the second fault on
+ * a page does not defer), so a bulk operation never stops half done.
+ */
+static int vm_phyaddr(struct pcb_t *caller, addr_t addr, addr_t *phyaddr)
+{
+  int fpn, ret, try = 0;
+
+  do {
+    ret = pg_getpage(caller->mm, PAGING64_PGN(addr), &fpn, caller);
+  } while (ret == PAGING_SWAP_PENDING && ++try < 4);
+  if (ret != 0)
+    return -1;
+
+  *phyaddr = ((addr_t)fpn << PAGING_ADDR_FPN_LOBIT) + PAGING_OFFST(addr);
+  return 0;
+}
+
+/*
+ * copy_vm - Copy @n bytes between virtual addresses of the caller
+ * Each source and destination page is translated once and the bytes in
+ * between are moved frame to frame. Faulting one page in may evict the
+ * other, so both translations are repeated until they agree.
+ */
+static int copy_vm(struct pcb_t *caller, addr_t src, addr_t dst, addr_t n)
+{
+  addr_t i, w, ps, pd, ps2, pd2, s, d;
+  int try;
+
+  for (i = 0; i < n; i += w) {
+    s = src + i;
+    d = dst + i;
+    w = PAGING_PAGESZ - PAGING_OFFST(s);
+    if (PAGING_PAGESZ - PAGING_OFFST(d) < w)
+      w = PAGING_PAGESZ - PAGING_OFFST(d);
+    if (n - i < w)
+      w = n - i;
+
+    if (vm_phyaddr(caller, s, &ps) < 0 || vm_phyaddr(caller, d, &pd) < 0)
+      return -1;
+    for (try = 0; try < 4; try++) {
+      if (vm_phyaddr(caller, s, &ps2) < 0 || vm_phyaddr(caller, d, &pd2) < 0)
+        return -1;
+      if (ps2 == ps && pd2 == pd)
+        break;
+      ps = ps2;
+      pd = pd2;
+    }
+    if (try == 4)
+      return -1;
+
+    pg_io_copy(caller, pd, ps, w);
+  }
+  return 0;
+}
+
+/* set_vm - Fill @n bytes at virtual address @dst, a page at a time */
+static int set_vm(struct pcb_t *caller, addr_t dst, BYTE value, addr_t n)
+{
+  addr_t i, w, pd, d;
+
+  for (i = 0; i < n; i += w) {
+    d = dst + i;
+    w = PAGING_PAGESZ - PAGING_OFFST(d);
+    if (n - i < w)
+      w = n - i;
+
+    if (vm_phyaddr(caller, d, &pd) < 0)
+      return -1;
+    pg_io_set(caller, pd, value, w);
+  }
+  return 0;
+}
+
+/* Whether [start, end) is all free space of the area */
+static int vm_range_free(struct vm_area_struct *vma, addr_t start, addr_t end)
+{
+  addr_t fs, fe;
+
+  return start >= end ||
+         (vm_freerg_lookup(vma, start, &fs, &fe) == 0 && fe >= end);
+}
+
+/*
+ * remap_region - move region [start, end) to @nstart, which has the same
+ * offset in its page. Pages owned by the region alone take their frame
+ * (or swap slot) along and the fresh frame mapped at the target is
+ * dropped; an edge page shared with a live neighbour is copied instead.
+ */
+static int remap_region(struct pcb_t *caller, struct vm_area_struct *vma,
+                        addr_t start, addr_t end, addr_t nstart)
+{
+  addr_t pgn, npgn, ps, pe, lo, hi;
+  uint32_t pte;
+
+  for (pgn = PAGING64_PGN(start); pgn <= PAGING64_PGN(end - 1); pgn++) {
+    ps = pgn * PAGING_PAGESZ;
+    pe = ps + PAGING_PAGESZ;
+    npgn = PAGING64_PGN(nstart) + (pgn - PAGING64_PGN(start));
+
+    if (vm_range_free(vma, ps, start) && vm_range_free(vma, end, pe)) {
+      release_pages(caller, npgn, npgn + 1);
+      pte = pte_get_entry(caller, pgn);
+      pte_set_entry(caller, npgn, pte);
+      if (!PAGING_PAGE_PRESENT(pte) && (pte & PAGING_PTE_SWAPPED_MASK))
+        swap_set_owner(PAGING_PTE_SWPTYP(pte), PAGING_SWP(pte), caller, npgn);
+      pte_set_entry(caller, pgn, 0);
+      tlb_clear_entry(caller->pid, pgn);
+      continue;
+    }
+
+    lo = (ps > start) ? ps : start;
+    hi = (pe < end) ? pe : end;
+    if (copy_vm(caller, lo, nstart + (lo - start), hi - lo) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/*
+ * __realloc - resize region @rgid to @size bytes
+ * A region shrinks in place and grows in place when the space after it
+ * is free or reaches sbrk; otherwise it moves to the top of its area
+ * keeping its frames (see remap_region). A slab object stays in its slot
+ * while it fits and is copied to a new object otherwise.
+ */
+int __realloc(struct pcb_t *caller, int rgid, addr_t size, addr_t *alloc_addr)
+{
+  struct mm_struct *mm = caller->mm;
+  struct vm_rg_struct *rgnode;
+  struct vm_area_struct *vma;
+  addr_t start, end, fs, fe, avail, nstart, base, off;
+  const char *how = "IN PLACE";
+
+  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+
+  rgnode = get_symrg_byid(mm, rgid);
+  if (rgnode == NULL || (rgnode->rg_start == 0 && rgnode->rg_end == 0)) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return __alloc(caller, VMA_HEAP, rgid, size, alloc_addr);
+  }
+  if (size == 0) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    *alloc_addr = 0;
+    return __free(caller, 0, rgid);
+  }
+
+  start = rgnode->rg_start;
+  end = rgnode->rg_end;
+  vma = find_vma(mm, start);
+  if (vma == NULL) {
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
+
+  if ((off = vm_slab_objsz(vma, start)) > 0) {
+    // Slab object: keep the slot while it fits, else copy to a new region
+    if (size > off) {
+      if (__alloc(caller, vma->vm_id, rgid, size, &nstart) < 0) {
+        pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+        return -1;
+      }
+      if (copy_vm(caller, start, nstart, end - start) < 0) {
+        // Drop the new region, the object keeps its slot
+        __free(caller, 0, rgid);
+        rgnode = get_symrg_byid(mm, rgid);
+        rgnode->rg_start = start;
+        rgnode->rg_end = end;
+        pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+        return -1;
+      }
+      vm_slab_free(vma, start);
+      start = nstart;
+      how = "COPY";
+    }
+  }
+  else if (start + size <= end) {
+    give_back(caller, vma, start + size, end);
+  }
+  else {
+    avail = end;
+    if (vm_freerg_lookup(vma, end, &fs, &fe) == 0)
+      avail = fe;
+    if (avail < start + size && avail == vma->sbrk &&
+        expand_heap(caller, vma->vm_id, vma,
+                    PAGING_PAGE_ALIGNSZ(start + size - avail), &base) == 0) {
+      vm_freerg_insert(vma, base, vma->sbrk);
+      avail = vma->sbrk;
+    }
+
+    if (avail >= start + size) {
+      vm_freerg_remove(vma, end, start + size);
+    }
+    else {
+      // Move to the top of the area, at the same offset in the page
+      off = start & ((addr_t)PAGING_PAGESZ - 1);
+      if (expand_heap(caller, vma->vm_id, vma,
+                      PAGING_PAGE_ALIGNSZ(off + size), &base) < 0) {
+        pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+        return -1;
+      }
+      nstart = base + off;
+      vm_freerg_insert(vma, base, nstart);
+      vm_freerg_insert(vma, nstart + size, vma->sbrk);
+
+      if (remap_region(caller, vma, start, end, nstart) < 0) {
+        pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+        return -1;
+      }
+      give_back(caller, vma, start, end);
+      start = nstart;
+      how = "REMAP";
+    }
+  }
+
+  rgnode = get_symrg_byid(mm, rgid);
+  rgnode->rg_start = start;
+  rgnode->rg_end = start + size;
+  *alloc_addr = start;
+
+  printf("=========> MEMORY REALLOCATION (%s) <=========\n", how);
+  printf("PID: %d | Region: %ld | Size: %ld | Address: %ld\n",
+         caller->pid, vma->vm_id, size, *alloc_addr);
+
   pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
   return 0;
 }
 
+/* ========================================================================= */
+/* BULK COPY AND FILL                                                        */
+/* ========================================================================= */
+
+/* Region @rgid when [offset, offset + size) lies inside it, else NULL */
+static struct vm_rg_struct *get_symrg_span(struct mm_struct *mm, int rgid,
+                                           addr_t offset, addr_t size)
+{
+  struct vm_rg_struct *rg = get_symrg_byid(mm, rgid);
+
+  if (rg == NULL || (rg->rg_start == 0 && rg->rg_end == 0) ||
+      offset > rg->rg_end - rg->rg_start ||
+      size > rg->rg_end - rg->rg_start - offset)
+    return NULL;
+  return rg;
+}
+
+/*
+ * __memcpy_rg - Copy @size bytes at @offset of region @srcrg to the same
+ * offset of region @dstrg
+ */
+int __memcpy_rg(struct pcb_t *caller, int srcrg, int dstrg, addr_t offset, addr_t size)
+{
+  struct vm_rg_struct *src, *dst;
+  int ret;
+
+  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+
+  src = get_symrg_span(caller->mm, srcrg, offset, size);
+  dst = get_symrg_span(caller->mm, dstrg, offset, size);
+  if (src == NULL || dst == NULL) {
+    printf("[ERROR] Segmentation fault at register %d\n", src ? dstrg : srcrg);
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
+
+  ret = copy_vm(caller, src->rg_start + offset, dst->rg_start + offset, size);
+  pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+  return ret;
+}
+
+/*
+ * __memset_rg - Fill @size bytes at @offset of region @rgid with @value
+ */
+int __memset_rg(struct pcb_t *caller, int rgid, addr_t offset, BYTE value, addr_t size)
+{
+  struct vm_rg_struct *rg;
+  int ret;
+
+  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+
+  rg = get_symrg_span(caller->mm, rgid, offset, size);
+  if (rg == NULL) {
+    printf("[ERROR] Segmentation fault at register %d\n", rgid);
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
+
+  ret = set_vm(caller, rg->rg_start + offset, value, size);
+  pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+  return ret;
+}
+
 /* ========================================================================= */
 /* WRAPPER FUNCTIONS                                                         */
 /* ========================================================================= */
 
-int liballoc(struct pcb_t *proc, addr_t size, uint32_t reg_index) 
+int liballoc(struct pcb_t *proc, int vmaid, addr_t size, uint32_t reg_index) 
+{
+  addr_t addr;
+  int val = __alloc(proc, vmaid, reg_index, size, &addr);
+  if (val == -1) return -1;
+  if (reg_index < PCB_NR_REGS)
+    proc->regs[reg_index] = addr;
+
+#ifdef IODUMP
+#ifdef PAGETBL_DUMP
+  print_pgtbl(proc, 0, -1);
+#endif
+#endif
+  return val;
+}
+
+int librealloc(struct pcb_t *proc, addr_t size, uint32_t reg_index) 
 {
   addr_t addr;
-  int val = __alloc(proc, 0, reg_index, size, &addr);
-  proc->regs[reg_index] = addr;
+  int val = __realloc(proc, reg_index, size, &addr);
   if (val == -1) return -1;
+  if (reg_index < PCB_NR_REGS)
+    proc->regs[reg_index] = addr;
 
 #ifdef IODUMP
 #ifdef PAGETBL_DUMP
@@ -543,6 +1073,8 @@ int libread(struct pcb_t *proc, uint32_t source, addr_t offset, uint32_t *destin
 {
   BYTE data;
   int val = __read(proc, 0, source, offset, &data);
+  if (val == PAGING_SWAP_PENDING)
+    return val;
   *destination = data;
   //print_fifo_status(proc->krnl->mm);
 
@@ -564,7 +1096,7 @@ int libread(struct pcb_t *proc, uint32_t source, addr_t offset, uint32_t *destin
 int libwrite(struct pcb_t *proc, BYTE data, uint32_t destination, addr_t offset) 
 {
   int val = __write(proc, 0, destination, offset, data);
-  if (val == -1) return -1;
+  if (val == -1 || val == PAGING_SWAP_PENDING) return val;
   //print_fifo_status(proc->krnl->mm);
 
   printf("[WRITE] PID: %d | Dst: %d | Offset: %ld | Value: %d\n",
@@ -582,59 +1114,161 @@ int libwrite(struct pcb_t *proc, BYTE data, uint32_t destination, addr_t offset)
   return val;
 }
 
+/*
+ * libread_n / libwrite_n - READ16/32/64 and WRITE16/32/64 of @nbytes
+ */
+int libread_n(struct pcb_t *proc, uint32_t source, addr_t offset, int nbytes, uint64_t *destination) 
+{
+  int val = __read_n(proc, 0, source, offset, nbytes, destination);
+  if (val == -1 || val == PAGING_SWAP_PENDING)
+    return val;
+
+  printf("\n");
+  printf("[READ%d] PID: %d | Src: %d | Offset: %ld | Value: %lu\n",
+         nbytes * 8, proc->pid, source, offset, (unsigned long)*destination);
+
+  print_tlb_stats();
+
+#ifdef IODUMP
+#ifdef PAGETBL_DUMP
+  print_pgtbl(proc, 0, -1);
+#endif
+#endif
+  return val;
+}
+
+int libwrite_n(struct pcb_t *proc, uint64_t data, uint32_t destination, addr_t offset, int nbytes) 
+{
+  int val = __write_n(proc, 0, destination, offset, nbytes, data);
+  if (val == -1 || val == PAGING_SWAP_PENDING)
+    return val;
+
+  printf("[WRITE%d] PID: %d | Dst: %d | Offset: %ld | Value: %lu\n",
+         nbytes * 8, proc->pid, destination, offset, (unsigned long)data);
+
+  print_tlb_stats();
+
+#ifdef IODUMP
+#ifdef PAGETBL_DUMP
+  print_pgtbl(proc, 0, -1);
+#endif
+  MEMPHY_dump(proc->krnl->mram);
+#endif
+  return val;
+}
+
+/*
+ * libmemcpy / libmemset - MEMCPY and MEMSET of a whole block in one
+ * instruction
+ */
+int libmemcpy(struct pcb_t *proc, uint32_t source, uint32_t destination, addr_t offset, addr_t size)
+{
+  int val = __memcpy_rg(proc, source, destination, offset, size);
+  if (val == -1) return val;
+
+  printf("[MEMCPY] PID: %d | Src: %d | Dst: %d | Offset: %ld | Size: %ld\n",
+         proc->pid, source, destination, offset, size);
+
+  print_tlb_stats();
+  return val;
+}
+
+int libmemset(struct pcb_t *proc, BYTE data, uint32_t destination, addr_t offset, addr_t size)
+{
+  int val = __memset_rg(proc, destination, offset, data, size);
+  if (val == -1) return val;
+
+  printf("[MEMSET] PID: %d | Dst: %d | Offset: %ld | Size: %ld | Value: %d\n",
+         proc->pid, destination, offset, size, data);
+
+  print_tlb_stats();
+  return val;
+}
+
 /* ========================================================================= */
 /* CLEANUP AND VICTIM SELECTION                                              */
 /* ========================================================================= */
 
 /*
  * free_pcb_memph - Free all memory of a process
+ * Frames and swap slots of every mapped page are released and the pages
+ * of the process are dropped from the global FIFO queue.
  */
 int free_pcb_memph(struct pcb_t *caller) 
 {
-  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
-  
-  int pagenum;
+  struct vm_area_struct *vma;
+  struct pgn_t **pp, *pg;
+  addr_t pagenum, endpgn;
   uint32_t pte;
 
-  for (pagenum = 0; pagenum < PAGING64_MAX_PGN; pagenum++) {
-    pte = pte_get_entry(caller, pagenum);
-    
-    if (PAGING_PAGE_PRESENT(pte)) {
-      int fpn = PAGING_FPN(pte);
-      MEMPHY_put_freefp(caller->krnl->mram, fpn);
-    }
-    else if (PAGING_PTE_SWP(pte)) {
-      addr_t swpfpn = PAGING_SWP(pte);
-      if (swpfpn != 0) {
-        MEMPHY_put_freefp(caller->krnl->active_mswp, swpfpn);
+  pthread_mutex_lock(&caller->krnl->mm->mm_lock);
+
+  for (vma = caller->mm->mmap; vma != NULL; vma = vma->vm_next) {
+    endpgn = PAGING64_PGN((vma->sbrk + PAGING_PAGESZ - 1));
+    for (pagenum = PAGING64_PGN(vma->vm_start); pagenum < endpgn; pagenum++) {
+      pte = pte_get_entry(caller, pagenum);
+
+      if (PAGING_PAGE_PRESENT(pte)) {
+        MEMPHY_put_freefp(caller->krnl->mram, PAGING_FPN(pte));
+      }
+      else if (pte & PAGING_PTE_SWAPPED_MASK) {
+        swap_put_slot(caller->krnl, PAGING_PTE_SWPTYP(pte), PAGING_SWP(pte));
       }
+      pte_set_entry(caller, pagenum, 0);
+
+      // [TLB ADDITION] Clear from TLB
+      tlb_clear_entry(caller->pid, pagenum);
     }
-    
-    // [TLB ADDITION] Clear from TLB
-    tlb_clear_entry(caller->pid, pagenum);
+    vm_freerg_destroy(vma);
+    vm_slab_destroy(vma);
   }
-  
+
+  free(caller->mm->symrgtbl);
+  caller->mm->symrgtbl = NULL;
+  caller->mm->symrgtbl_sz = 0;
+
+  pp = &caller->krnl->mm->fifo_pgn;
+  while (*pp != NULL) {
+    pg = *pp;
+    if (pg->owner == caller) {
+      *pp = pg->pg_next;
+      free(pg);
+    } else {
+      pp = &pg->pg_next;
+    }
+  }
+
   pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
   return 0;
 }
 
 /*
  * find_victim_page - FIFO page replacement
- * Select oldest page from global queue
+ * Select oldest page (tail) from global queue
  */
 int find_victim_page(struct mm_struct *mm, int *retpgn, struct pcb_t **ret_owner)
 {
   struct pgn_t *pg = mm->fifo_pgn;
+  struct pgn_t *prev = NULL;
   if (!pg) {
     printf("[ERROR] FIFO queue is empty!\n");
     return -1;
   }
 
+  // New pages are enlisted at the head, the oldest one is the tail
+  while (pg->pg_next) {
+    prev = pg;
+    pg = pg->pg_next;
+  }
+
   *retpgn = pg->pgn;
   *ret_owner = pg->owner;
 
   // Remove from list
-  mm->fifo_pgn = pg->pg_next;
+  if (prev)
+    prev->pg_next = NULL;
+  else
+    mm->fifo_pgn = NULL;
   free(pg);
 
   return 0;
@@ -682,37 +1316,12 @@ int get_free_vmrg_area(struct pcb_t *caller, int vmaid, int size,
   struct vm_area_struct *cur_vma = get_vma_by_num(caller->mm, vmaid);
   if (cur_vma == NULL) return -1;
 
-  struct vm_rg_struct *rgit = cur_vma->vm_freerg_list;
-  struct vm_rg_struct *prev = NULL;
-  
-  if (rgit == NULL) return -1;
-  
-  while (rgit != NULL) {
-    long current_space = rgit->rg_end - rgit->rg_start;
-    
-    if (current_space >= size) {
-      // Found suitable region
-      newrg->rg_start = rgit->rg_start;
-      newrg->rg_end = rgit->rg_start + size;
-      
-      if (current_space > size) {
-        // Shrink region
-        rgit->rg_start += size;
-      } else {
-        // Remove region from list (exact fit)
-        if (prev != NULL) 
-          prev->rg_next = rgit->rg_next;
-        else 
-          cur_vma->vm_freerg_list = rgit->rg_next;
-        free(rgit);
-      }
-      
-      return 0;
-    }
-    
-    prev = rgit;
-    rgit = rgit->rg_next;
-  }
-  
-  return -1;  // No suitable region found
+  addr_t start;
+
+  if (size <= 0 || vm_freerg_alloc(cur_vma, size, &start) < 0)
+    return -1;  // No suitable region found
+
+  newrg->rg_start = start;
+  newrg->rg_end = start + size;
+  return 0;
 }
\ No newline at end of file
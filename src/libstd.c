@@ -10,6 +10,8 @@
 
 #include "../include/common.h"
 #include "../include/syscall.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 int libsyscall (struct pcb_t *caller,
              uint32_t syscall_idx,
@@ -32,6 +34,104 @@ int libsyscall (struct pcb_t *caller,
    regs.a1 = a1;
    regs.a2 = a2;
    regs.a3 = a3;
+   regs.a4 = 0;
+   regs.a5 = 0;
+   regs.a6 = 0;
 
    return syscall(caller->krnl, caller->pid, syscall_idx, &regs);
 }
+
+/*
+ * libsyscall_submit - queue syscall @syscall_idx on the ring of @caller
+ * without entering the kernel. Returns the slot whose sc_regs receive the
+ * results, -1 when every slot still waits to be reaped.
+ */
+int libsyscall_submit(struct pcb_t *caller,
+             uint32_t syscall_idx,
+             arg_t a1,
+             arg_t a2,
+             arg_t a3,
+             arg_t a4)
+{
+   struct sc_ring *ring = caller->sc_ring;
+   struct sc_regs *sqe;
+
+   if (ring == NULL &&
+       (ring = caller->sc_ring = calloc(1, sizeof(struct sc_ring))) == NULL)
+      return -1;
+   if (ring->sq_tail - ring->cq_head >= SC_RING_SZ)
+      return -1;
+
+   sqe = &ring->sqe[ring->sq_tail & (SC_RING_SZ - 1)];
+   sqe->a1 = a1;
+   sqe->a2 = a2;
+   sqe->a3 = a3;
+   sqe->a4 = a4;
+   sqe->a5 = 0;
+   sqe->a6 = 0;
+   sqe->orig_ax = syscall_idx;
+   sqe->flags = 0;
+   ring->sq_tail++;
+
+   return sqe - ring->sqe;
+}
+
+/*
+ * libsyscall_enter - hand the queued entries to the kernel in one
+ * syscall, returns how many were completed
+ */
+int libsyscall_enter(struct pcb_t *caller)
+{
+   struct sc_regs regs;
+
+   if (caller->sc_ring == NULL || caller->sc_ring->sq_head == caller->sc_ring->sq_tail)
+      return 0;
+
+   regs.a1 = 0;
+   return syscall(caller->krnl, caller->pid, 18, &regs);
+}
+
+/*
+ * libsyscall_reap - take the oldest completion, copying out its entry and
+ * return value. Returns -1 when no completion is pending.
+ */
+int libsyscall_reap(struct pcb_t *caller, struct sc_regs *regs, int *ret)
+{
+   struct sc_ring *ring = caller->sc_ring;
+   struct sc_cqe *cqe;
+
+   if (ring == NULL || ring->cq_head == ring->cq_tail)
+      return -1;
+
+   cqe = &ring->cqe[ring->cq_head & (SC_RING_SZ - 1)];
+   if (regs != NULL)
+      *regs = ring->sqe[cqe->idx];
+   if (ret != NULL)
+      *ret = cqe->ret;
+   ring->cq_head++;
+
+   return 0;
+}
+
+/*
+ * libsyscall_flush - enter the kernel with whatever is queued and reap
+ * every completion. Returns how many were reaped, -1 if the kernel
+ * refused the batch.
+ */
+int libsyscall_flush(struct pcb_t *caller)
+{
+   struct sc_regs regs;
+   int ret;
+   int nr = 0;
+
+   if (libsyscall_enter(caller) < 0)
+      return -1;
+
+   while (libsyscall_reap(caller, &regs, &ret) == 0) {
+      printf("[SCRING] PID: %d | NR: %u | Ret: %d | a3: " FORMAT_ARG "\n",
+             caller->pid, regs.orig_ax, ret, regs.a3);
+      nr++;
+   }
+
+   return nr;
+}
@@ -13,6 +13,17 @@ static uint32_t avail_pid = 1;
 #define OPT_READ    "read"
 #define OPT_WRITE   "write"
 #define OPT_SYSCALL "syscall"
+#define OPT_READ16  "read16"
+#define OPT_READ32  "read32"
+#define OPT_READ64  "read64"
+#define OPT_WRITE16 "write16"
+#define OPT_WRITE32 "write32"
+#define OPT_WRITE64 "write64"
+#define OPT_REALLOC "realloc"
+#define OPT_MEMCPY  "memcpy"
+#define OPT_MEMSET  "memset"
+#define OPT_SUBMIT  "submit"
+#define OPT_ENTER   "enter"
 
 static enum ins_opcode_t get_opcode(char * opt) {
     if (!strcmp(opt, OPT_CALC)) {
@@ -27,6 +38,28 @@ static enum ins_opcode_t get_opcode(char * opt) {
         return WRITE;
     }else if (!strcmp(opt, OPT_SYSCALL)) {
         return SYSCALL;
+    }else if (!strcmp(opt, OPT_READ16)) {
+        return READ16;
+    }else if (!strcmp(opt, OPT_READ32)) {
+        return READ32;
+    }else if (!strcmp(opt, OPT_READ64)) {
+        return READ64;
+    }else if (!strcmp(opt, OPT_WRITE16)) {
+        return WRITE16;
+    }else if (!strcmp(opt, OPT_WRITE32)) {
+        return WRITE32;
+    }else if (!strcmp(opt, OPT_WRITE64)) {
+        return WRITE64;
+    }else if (!strcmp(opt, OPT_REALLOC)) {
+        return REALLOC;
+    }else if (!strcmp(opt, OPT_MEMCPY)) {
+        return MEMCPY;
+    }else if (!strcmp(opt, OPT_MEMSET)) {
+        return MEMSET;
+    }else if (!strcmp(opt, OPT_SUBMIT)) {
+        return SUBMIT;
+    }else if (!strcmp(opt, OPT_ENTER)) {
+        return ENTER;
     }else{
         printf("Opcode: %s\n", opt);
         exit(1);
@@ -41,6 +74,7 @@ struct pcb_t * load(const char * path) {
     proc->page_table = (struct page_table_t*)malloc(sizeof(struct page_table_t));
     proc->bp = PAGE_SIZE;
     proc->pc = 0;
+    proc->sc_ring = NULL;
 
     // [FIX 1] Cấp phát và Khởi tạo MM riêng cho Process
     // Đây là bước quan trọng nhất để tránh Segmentation Fault ở liballoc
@@ -81,6 +115,16 @@ struct pcb_t * load(const char * path) {
         case CALC:
             break;
         case ALLOC:
+            /* alloc SIZE REG [VMAID], the heap area by default */
+            fgets(buf, sizeof(buf), file);
+            proc->code->text[i].arg_2 = VMA_HEAP;
+            sscanf(buf, "" FORMAT_ARG " " FORMAT_ARG " " FORMAT_ARG "",
+                       &proc->code->text[i].arg_0,
+                       &proc->code->text[i].arg_1,
+                       &proc->code->text[i].arg_2
+            );
+            break;
+        case REALLOC:
             fscanf(
                 file,
                 "" FORMAT_ARG " " FORMAT_ARG "\n",
@@ -91,8 +135,25 @@ struct pcb_t * load(const char * path) {
         case FREE:
             fscanf(file, "" FORMAT_ARG "\n", &proc->code->text[i].arg_0);
             break;
+        case MEMCPY: /* memcpy SRC DST OFFSET SIZE, same OFFSET in both regions */
+        case MEMSET: /* memset VALUE DST OFFSET SIZE */
+            fscanf(
+                file,
+                "" FORMAT_ARG " " FORMAT_ARG " " FORMAT_ARG " " FORMAT_ARG "\n",
+                &proc->code->text[i].arg_0,
+                &proc->code->text[i].arg_1,
+                &proc->code->text[i].arg_2,
+                &proc->code->text[i].arg_3
+            );
+            break;
         case READ:
         case WRITE:
+        case READ16:
+        case READ32:
+        case READ64:
+        case WRITE16:
+        case WRITE32:
+        case WRITE64:
             fscanf(
                 file,
                 "" FORMAT_ARG " " FORMAT_ARG " " FORMAT_ARG "\n",
@@ -101,6 +162,9 @@ struct pcb_t * load(const char * path) {
                 &proc->code->text[i].arg_2
             );
             break;  
+        case ENTER:
+            break;
+        case SUBMIT: /* submit NR A1 A2 A3, queued until the next enter */
         case SYSCALL:
             fgets(buf, sizeof(buf), file);
             sscanf(buf, "" FORMAT_ARG "" FORMAT_ARG "" FORMAT_ARG "" FORMAT_ARG "",
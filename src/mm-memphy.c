@@ -19,27 +19,104 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* CPU of the calling thread, -1 for kernel threads (no magazine) */
+static __thread int memphy_cpu = -1;
+
+/* Device time spent by the calling thread, see MEMPHY_take_io_time() */
+static __thread unsigned long memphy_io_time = 0;
+
+static void memphy_charge(struct memphy_struct *mp, unsigned long cost)
+{
+   mp->io_time += cost;
+   memphy_io_time += cost;
+}
+
+/*
+ *  memphy_node_of - NUMA node holding frame @fpn, the last node also
+ *  takes the frames left over by the even split
+ */
+static int memphy_node_of(struct memphy_struct *mp, addr_t fpn)
+{
+   addr_t node;
+
+   if (mp->nr_nodes <= 1)
+      return 0;
+   node = fpn / mp->nodes[0].nr_fp;
+   return (node < (addr_t)mp->nr_nodes) ? (int)node : mp->nr_nodes - 1;
+}
+
+/*
+ *  memphy_cpu_node - NUMA node of the calling CPU, -1 for kernel threads
+ */
+static int memphy_cpu_node(struct memphy_struct *mp)
+{
+   if (mp->nr_nodes <= 1 || memphy_cpu < 0)
+      return -1;
+   return memphy_cpu * mp->nr_nodes / mp->numa_ncpu;
+}
+
+/*
+ *  memphy_numa_access - classify a CPU access to @addr as local or remote
+ *  Called with memphy_lock held.
+ */
+static void memphy_numa_access(struct memphy_struct *mp, addr_t addr)
+{
+   int cpunode = memphy_cpu_node(mp);
+   struct memphy_node *node;
+
+   if (cpunode < 0)
+      return;
+
+   node = &mp->nodes[memphy_node_of(mp, addr / PAGING_PAGESZ)];
+   if (node == &mp->nodes[cpunode]) {
+      node->nr_local++;
+      mp->numa_time += NUMA_LOCAL_COST;
+   } else {
+      node->nr_remote++;
+      mp->numa_time += mp->numa_remote_cost;
+   }
+}
 
 /*
  *  MEMPHY_mv_csr - move MEMPHY cursor
  *  @mp: memphy struct
  *  @offset: offset
+ *
+ *  The head travel is charged as seek time (per page of distance) plus
+ *  one rotational latency when the head leaves its current position.
  */
 int MEMPHY_mv_csr(struct memphy_struct *mp, addr_t offset)
 {
-   int numstep = 0;
+   addr_t dist;
 
-   mp->cursor = 0;
-   while (numstep < offset && numstep < mp->maxsz)
+   offset %= mp->maxsz;
+   dist = (offset > mp->cursor) ? offset - mp->cursor : mp->cursor - offset;
+
+   if (dist > 0)
    {
-      /* Traverse sequentially */
-      mp->cursor = (mp->cursor + 1) % mp->maxsz;
-      numstep++;
+      memphy_charge(mp, dist * mp->seek_cost / PAGING_PAGESZ + mp->rot_cost);
+      mp->seek_dist += dist;
+      mp->nr_seek++;
    }
+   mp->cursor = offset;
 
    return 0;
 }
 
+/*
+ *  MEMPHY_mv_xfer - transfer @nbytes under the head and move past them
+ */
+static void MEMPHY_mv_xfer(struct memphy_struct *mp, addr_t nbytes)
+{
+   memphy_charge(mp, nbytes * mp->xfer_cost / PAGING_PAGESZ);
+   mp->nr_io++;
+   mp->cursor = (mp->cursor + nbytes) % mp->maxsz;
+}
+
 /*
  *  MEMPHY_seq_read - read MEMPHY device
  *  @mp: memphy struct
@@ -50,11 +127,12 @@ int MEMPHY_seq_read(struct memphy_struct *mp, addr_t addr, BYTE *value)
 {
    if (mp == NULL)
       return -1;
-   if (!mp->rdmflg)
+   if (mp->rdmflg)
       return -1; /* Not compatible mode for sequential read */
 
    MEMPHY_mv_csr(mp, addr);
    *value = (BYTE)mp->storage[addr];
+   MEMPHY_mv_xfer(mp, 1);
    return 0;
 }
 
@@ -72,6 +150,7 @@ int MEMPHY_read(struct memphy_struct *mp, addr_t addr, BYTE *value)
    pthread_mutex_lock(&mp->memphy_lock);
    int ret = 0;
 
+   memphy_numa_access(mp, addr);
    if (mp->rdmflg)
       *value = mp->storage[addr];
    else /* Sequential access device */
@@ -94,11 +173,12 @@ int MEMPHY_seq_write(struct memphy_struct *mp, addr_t addr, BYTE value)
    if (mp == NULL)
       return -1;
 
-   if (!mp->rdmflg)
-      return -1; /* Not compatible mode for sequential read */
+   if (mp->rdmflg)
+      return -1; /* Not compatible mode for sequential write */
 
    MEMPHY_mv_csr(mp, addr);
    mp->storage[addr] = value;
+   MEMPHY_mv_xfer(mp, 1);
 
    return 0;
 }
@@ -117,6 +197,7 @@ int MEMPHY_write(struct memphy_struct *mp, addr_t addr, BYTE data)
    pthread_mutex_lock(&mp->memphy_lock);
    int ret = 0;
 
+   memphy_numa_access(mp, addr);
    if (mp->rdmflg)
       mp->storage[addr] = data;
    else /* Sequential access device */
@@ -127,93 +208,880 @@ int MEMPHY_write(struct memphy_struct *mp, addr_t addr, BYTE data)
    return ret;
 }
 
+/*
+ *  MEMPHY_direct - host address of @nbytes at @addr of a random access
+ *  device, for an access already validated by the pager. NULL for a
+ *  sequential device, whose cursor needs the locked path.
+ */
+BYTE *MEMPHY_direct(struct memphy_struct *mp, addr_t addr, int nbytes)
+{
+   if (mp == NULL || !mp->rdmflg || addr + nbytes > mp->maxsz)
+      return NULL;
+
+   if (mp->nr_nodes > 1) {
+      pthread_mutex_lock(&mp->memphy_lock);
+      memphy_numa_access(mp, addr);
+      pthread_mutex_unlock(&mp->memphy_lock);
+   }
+   return mp->storage + addr;
+}
+
+/*
+ *  MEMPHY_read_wide - read @nbytes (up to 8) little endian bytes at once
+ *  @mp: memphy struct
+ *  @addr: address of the first byte
+ *  @value: obtained value
+ */
+int MEMPHY_read_wide(struct memphy_struct *mp, addr_t addr, int nbytes, uint64_t *value)
+{
+   int i;
+
+   if (mp == NULL || nbytes < 1 || nbytes > 8 || addr + nbytes > mp->maxsz)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   memphy_numa_access(mp, addr);
+   if (!mp->rdmflg)
+      MEMPHY_mv_csr(mp, addr);
+
+   *value = 0;
+   for (i = 0; i < nbytes; i++)
+      *value |= (uint64_t)(unsigned char)mp->storage[addr + i] << (8 * i);
+
+   if (!mp->rdmflg)
+      MEMPHY_mv_xfer(mp, nbytes);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return 0;
+}
+
+/*
+ *  MEMPHY_write_wide - write @nbytes (up to 8) little endian bytes at once
+ *  @mp: memphy struct
+ *  @addr: address of the first byte
+ *  @value: written value
+ */
+int MEMPHY_write_wide(struct memphy_struct *mp, addr_t addr, int nbytes, uint64_t value)
+{
+   int i;
+
+   if (mp == NULL || nbytes < 1 || nbytes > 8 || addr + nbytes > mp->maxsz)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   memphy_numa_access(mp, addr);
+   if (!mp->rdmflg)
+      MEMPHY_mv_csr(mp, addr);
+
+   for (i = 0; i < nbytes; i++)
+      mp->storage[addr + i] = (BYTE)(value >> (8 * i));
+
+   if (!mp->rdmflg)
+      MEMPHY_mv_xfer(mp, nbytes);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return 0;
+}
+
+/*
+ *  MEMPHY_copy - copy @n bytes from @src to @dst inside the device
+ *  A sequential device pays a seek and a transfer for each side.
+ */
+int MEMPHY_copy(struct memphy_struct *mp, addr_t dst, addr_t src, addr_t n)
+{
+   if (mp == NULL || src + n > mp->maxsz || dst + n > mp->maxsz)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   memphy_numa_access(mp, src);
+   memphy_numa_access(mp, dst);
+   if (!mp->rdmflg)
+   {
+      MEMPHY_mv_csr(mp, src);
+      MEMPHY_mv_xfer(mp, n);
+      MEMPHY_mv_csr(mp, dst);
+      MEMPHY_mv_xfer(mp, n);
+   }
+   memmove(mp->storage + dst, mp->storage + src, n);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return 0;
+}
+
+/*
+ *  MEMPHY_set - fill @n bytes at @addr with @value
+ */
+int MEMPHY_set(struct memphy_struct *mp, addr_t addr, BYTE value, addr_t n)
+{
+   if (mp == NULL || addr + n > mp->maxsz)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   memphy_numa_access(mp, addr);
+   if (!mp->rdmflg)
+   {
+      MEMPHY_mv_csr(mp, addr);
+      MEMPHY_mv_xfer(mp, n);
+   }
+   memset(mp->storage + addr, value, n);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return 0;
+}
+
+/*
+ *  MEMPHY_frame_addr - start address of a frame, -1 when out of device
+ *  Moves the cursor of a sequential device past the accessed frame and
+ *  charges the access to the device time.
+ */
+static long MEMPHY_frame_addr(struct memphy_struct *mp, addr_t fpn)
+{
+   addr_t addr = fpn * PAGING_PAGESZ;
+
+   if (addr + PAGING_PAGESZ > mp->maxsz)
+      return -1;
+
+   if (!mp->rdmflg)
+   {
+      MEMPHY_mv_csr(mp, addr);
+      MEMPHY_mv_xfer(mp, PAGING_PAGESZ);
+   }
+
+   return addr;
+}
+
+/*
+ *  MEMPHY_read_frame - read a whole frame of MEMPHY device
+ *  @mp: memphy struct
+ *  @fpn: frame number
+ *  @buf: PAGING_PAGESZ bytes buffer
+ */
+int MEMPHY_read_frame(struct memphy_struct *mp, addr_t fpn, BYTE *buf)
+{
+   long addr;
+
+   if (mp == NULL)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   addr = MEMPHY_frame_addr(mp, fpn);
+   if (addr >= 0)
+      memcpy(buf, mp->storage + addr, PAGING_PAGESZ);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return (addr < 0) ? -1 : 0;
+}
+
+/*
+ *  MEMPHY_write_frame - write a whole frame of MEMPHY device
+ *  @mp: memphy struct
+ *  @fpn: frame number
+ *  @buf: PAGING_PAGESZ bytes buffer
+ */
+int MEMPHY_write_frame(struct memphy_struct *mp, addr_t fpn, BYTE *buf)
+{
+   long addr;
+
+   if (mp == NULL)
+      return -1;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   addr = MEMPHY_frame_addr(mp, fpn);
+   if (addr >= 0)
+      memcpy(mp->storage + addr, buf, PAGING_PAGESZ);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return (addr < 0) ? -1 : 0;
+}
+
+/*
+ *  MEMPHY_copy_frame - copy a frame between (or inside) MEMPHY devices
+ *  @mpsrc: source device
+ *  @srcfpn: source frame number
+ *  @mpdst: destination device
+ *  @dstfpn: destination frame number
+ *
+ *  Both device locks are held for a single memcpy, they are taken in
+ *  address order so that concurrent copies in opposite directions
+ *  cannot deadlock.
+ */
+int MEMPHY_copy_frame(struct memphy_struct *mpsrc, addr_t srcfpn,
+                      struct memphy_struct *mpdst, addr_t dstfpn)
+{
+   struct memphy_struct *first = mpsrc, *second = mpdst;
+   long addrsrc, addrdst;
+
+   if (mpsrc == NULL || mpdst == NULL)
+      return -1;
+
+   if (first > second)
+   {
+      first = mpdst;
+      second = mpsrc;
+   }
+
+   pthread_mutex_lock(&first->memphy_lock);
+   if (second != first)
+      pthread_mutex_lock(&second->memphy_lock);
+
+   addrsrc = MEMPHY_frame_addr(mpsrc, srcfpn);
+   addrdst = MEMPHY_frame_addr(mpdst, dstfpn);
+   if (addrsrc >= 0 && addrdst >= 0)
+      memmove(mpdst->storage + addrdst, mpsrc->storage + addrsrc, PAGING_PAGESZ);
+
+   if (second != first)
+      pthread_mutex_unlock(&second->memphy_lock);
+   pthread_mutex_unlock(&first->memphy_lock);
+
+   return (addrsrc < 0 || addrdst < 0) ? -1 : 0;
+}
+
 /*
  *  MEMPHY_format-format MEMPHY device
  *  @mp: memphy struct
+ *
+ *  A bit of the frame bitmap is set when the frame is in use, so that the
+ *  zero filled bitmap of calloc() has every frame free without touching
+ *  it: the cost no longer grows with the device size.
  */
 int MEMPHY_format(struct memphy_struct *mp, int pagesz)
 {
    /* This setting come with fixed constant PAGESZ */
    int numfp = mp->maxsz / pagesz;
-   struct framephy_struct *newfst, *fst;
-   int iter = 0;
+
+   mp->fp_bitmap = NULL;
+   mp->fp_nwords = 0;
+   mp->fp_cursor = 0;
+   mp->free_fp_cnt = 0;
+   mp->buddy_norder = 0;
+   mp->nr_mags = 0;
+   mp->fp_cached = NULL;
+   mp->mag_cached = 0;
+   mp->nr_nodes = 1;
+   mp->nodes = NULL;
 
    if (numfp <= 0)
       return -1;
 
-   /* Init head of free framephy list */
-   fst = malloc(sizeof(struct framephy_struct));
-   fst->fpn = iter;
-   mp->free_fp_list = fst;
+   mp->fp_nwords = DIV_ROUND_UP(numfp, 64);
+   mp->fp_bitmap = calloc(mp->fp_nwords, sizeof(uint64_t));
 
-   /* We have list with first element, fill in the rest num-1 element member*/
-   for (iter = 1; iter < numfp; iter++)
-   {
-      newfst = malloc(sizeof(struct framephy_struct));
-      newfst->fpn = iter;
-      newfst->fp_next = NULL;
-      fst->fp_next = newfst;
-      fst = newfst;
+   /* Frames past the end of the device do not exist */
+   if (numfp % 64)
+      mp->fp_bitmap[mp->fp_nwords - 1] = ~(BIT_ULL(numfp % 64) - 1);
+
+   mp->free_fp_cnt = numfp;
+
+   return 0;
+}
+
+/*
+ *  Buddy allocator helpers, called with memphy_lock held. A free block of
+ *  order k is 2^k frames aligned on 2^k, its buddy is fpn ^ 2^k. Each
+ *  NUMA node has its own free lists and blocks never span two nodes.
+ */
+#define BUDDY_HEAD(mp, node, order) ((mp)->buddy_head[(node) * (mp)->buddy_norder + (order)])
+
+static void buddy_list_add(struct memphy_struct *mp, int fpn, int order)
+{
+   int *head = &BUDDY_HEAD(mp, memphy_node_of(mp, fpn), order);
+
+   mp->buddy_blk[fpn] = order + 1;
+   mp->buddy_prev[fpn] = -1;
+   mp->buddy_next[fpn] = *head;
+   if (*head >= 0)
+      mp->buddy_prev[*head] = fpn;
+   *head = fpn;
+}
+
+static void buddy_list_del(struct memphy_struct *mp, int fpn, int order)
+{
+   if (mp->buddy_prev[fpn] >= 0)
+      mp->buddy_next[mp->buddy_prev[fpn]] = mp->buddy_next[fpn];
+   else
+      BUDDY_HEAD(mp, memphy_node_of(mp, fpn), order) = mp->buddy_next[fpn];
+   if (mp->buddy_next[fpn] >= 0)
+      mp->buddy_prev[mp->buddy_next[fpn]] = mp->buddy_prev[fpn];
+   mp->buddy_blk[fpn] = 0;
+}
+
+/*
+ *  buddy_alloc - take a block of @order, splitting a larger one if needed
+ *  The block frames are handed out as separate frames, each one is later
+ *  released on its own by buddy_free().
+ *
+ *  First touch: the block comes from the node of the calling CPU, other
+ *  nodes are tried in turn when it has none. Kernel threads interleave
+ *  their allocations over the nodes.
+ */
+static int buddy_alloc(struct memphy_struct *mp, int order, addr_t *retfpn)
+{
+   int cur = mp->buddy_norder, fpn, iter, it, node = 0;
+   int pref = memphy_cpu_node(mp);
+
+   if (pref < 0)
+      pref = mp->numa_rr++ % mp->nr_nodes;
+
+   for (it = 0; it < mp->nr_nodes && cur >= mp->buddy_norder; it++) {
+      node = (pref + it) % mp->nr_nodes;
+      for (cur = order; cur < mp->buddy_norder; cur++)
+         if (BUDDY_HEAD(mp, node, cur) >= 0)
+            break;
+   }
+   if (cur >= mp->buddy_norder)
+      return -1;
+   if (node != pref)
+      mp->nodes[pref].nr_fallback++;
+
+   fpn = BUDDY_HEAD(mp, node, cur);
+   buddy_list_del(mp, fpn, cur);
+
+   /* Give back the upper halves until the block has the wanted order */
+   while (cur > order) {
+      cur--;
+      buddy_list_add(mp, fpn + (1 << cur), cur);
    }
 
+   for (iter = fpn; iter < fpn + (1 << order); iter++)
+      mp->fp_bitmap[iter / 64] |= BIT_ULL(iter % 64);
+   mp->free_fp_cnt -= 1 << order;
+
+   *retfpn = fpn;
    return 0;
 }
 
-int MEMPHY_get_freefp(struct memphy_struct *mp, addr_t *retfpn)
+/*
+ *  buddy_free - release one frame and merge it with its free buddies
+ */
+static void buddy_free(struct memphy_struct *mp, int fpn)
 {
-   pthread_mutex_lock(&mp->memphy_lock);
+   int order = 0, buddy;
+   int numfp = mp->maxsz / PAGING_PAGESZ;
 
-   struct framephy_struct *fp = mp->free_fp_list;
+   mp->fp_bitmap[fpn / 64] &= ~BIT_ULL(fpn % 64);
+   mp->free_fp_cnt++;
 
-   if (fp == NULL) {
-      pthread_mutex_unlock(&mp->memphy_lock);
+   while (order < mp->buddy_norder - 1) {
+      buddy = fpn ^ (1 << order);
+      if (buddy >= numfp || mp->buddy_blk[buddy] != order + 1 ||
+          memphy_node_of(mp, buddy) != memphy_node_of(mp, fpn))
+         break;
+
+      buddy_list_del(mp, buddy, order);
+      if (buddy < fpn)
+         fpn = buddy;
+      order++;
+   }
+
+   buddy_list_add(mp, fpn, order);
+}
+
+/*
+ *  MEMPHY_numa_init - split a freshly formatted device into NUMA nodes
+ *  @nnodes: number of nodes, each one holds an even share of the frames
+ *  @ncpu: CPUs, spread in contiguous blocks over the nodes
+ *  @remote_cost: cost of an access to another node than the CPU one
+ *
+ *  Must come before MEMPHY_buddy_init(), which keeps free lists per node.
+ */
+int MEMPHY_numa_init(struct memphy_struct *mp, int nnodes, int ncpu,
+                     unsigned long remote_cost)
+{
+   int numfp = mp->maxsz / PAGING_PAGESZ;
+   int node;
+
+   if (nnodes <= 1 || ncpu <= 0 || numfp < nnodes)
       return -1;
+
+   mp->nodes = calloc(nnodes, sizeof(struct memphy_node));
+   for (node = 0; node < nnodes; node++) {
+      mp->nodes[node].start_fp = node * (numfp / nnodes);
+      mp->nodes[node].nr_fp = numfp / nnodes;
    }
-   *retfpn = fp->fpn;
-   mp->free_fp_list = fp->fp_next;
+   mp->nodes[nnodes - 1].nr_fp += numfp % nnodes;
 
-   /* MEMPHY is iteratively used up until its exhausted
-    * No garbage collector acting then it not been released
+   mp->nr_nodes = nnodes;
+   mp->numa_ncpu = ncpu;
+   mp->numa_remote_cost = remote_cost;
+   mp->numa_time = 0;
+   mp->numa_rr = 0;
+   return 0;
+}
+
+/*
+ *  MEMPHY_buddy_init - manage the frames of a freshly formatted device
+ *  with a buddy allocator
+ *  @mp: memphy struct, all frames free
+ *  @maxorder: largest block is 2^maxorder frames
+ */
+int MEMPHY_buddy_init(struct memphy_struct *mp, int maxorder)
+{
+   int numfp = mp->maxsz / PAGING_PAGESZ;
+   int fpn, order, node, start, it;
+
+   if (numfp <= 0)
+      return -1;
+
+   mp->buddy_norder = maxorder + 1;
+   mp->buddy_head = malloc(mp->nr_nodes * mp->buddy_norder * sizeof(int));
+   mp->buddy_next = malloc(numfp * sizeof(int));
+   mp->buddy_prev = malloc(numfp * sizeof(int));
+   mp->buddy_blk = calloc(numfp, sizeof(signed char));
+
+   for (it = 0; it < mp->nr_nodes * mp->buddy_norder; it++)
+      mp->buddy_head[it] = -1;
+
+   /*
+    * Carve the frames of each node into the largest aligned blocks. They
+    * are pushed from the top down so that low frames are handed out first.
     */
-   free(fp);
+   for (fpn = numfp; fpn > 0; fpn -= 1 << order) {
+      node = memphy_node_of(mp, fpn - 1);
+      start = (mp->nr_nodes > 1) ? mp->nodes[node].start_fp : 0;
+      order = maxorder;
+      while (((fpn - (1 << order)) & ((1 << order) - 1)) || fpn - (1 << order) < start)
+         order--;
+      buddy_list_add(mp, fpn - (1 << order), order);
+   }
+
+   return 0;
+}
+
+/*
+ *  MEMPHY_get_freefp_range - allocate 2^@order contiguous frames
+ *  @retfpn: first frame of the run
+ */
+int MEMPHY_get_freefp_range(struct memphy_struct *mp, int order, addr_t *retfpn)
+{
+   int ret;
+
+   if (order >= mp->buddy_norder)
+      return -1;
 
+   pthread_mutex_lock(&mp->memphy_lock);
+   ret = buddy_alloc(mp, order, retfpn);
    pthread_mutex_unlock(&mp->memphy_lock);
 
+   return ret;
+}
+
+/*
+ *  MEMPHY_frag_index - unusable free space index for an allocation of
+ *  @order: the part of the free frames which lies in smaller blocks,
+ *  0 when every free frame can serve it, 1 when none can
+ */
+double MEMPHY_frag_index(struct memphy_struct *mp, int order)
+{
+   int cur, fpn, node, usable = 0;
+   double idx;
+
+   if (mp->buddy_norder == 0)
+      return 0.0;
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   for (node = 0; node < mp->nr_nodes; node++)
+      for (cur = order; cur < mp->buddy_norder; cur++)
+         for (fpn = BUDDY_HEAD(mp, node, cur); fpn >= 0; fpn = mp->buddy_next[fpn])
+            usable += 1 << cur;
+   idx = (mp->free_fp_cnt > 0) ?
+         (double)(mp->free_fp_cnt - usable) / mp->free_fp_cnt : 0.0;
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   return idx;
+}
+
+void MEMPHY_print_stats(struct memphy_struct *mp, const char *name)
+{
+   int order, cached = mp->mag_cached;
+
+   printf("[MEMPHY STATS] %s: %d/%lu frames free", name, mp->free_fp_cnt + cached,
+          (unsigned long)(mp->maxsz / PAGING_PAGESZ));
+   if (mp->nr_mags > 0)
+      printf(" (%d in CPU magazines)", cached);
+   if (mp->buddy_norder > 0) {
+      printf(" | fragmentation index");
+      for (order = 1; order < mp->buddy_norder && order <= 4; order++)
+         printf(" o%d %.2f", order, MEMPHY_frag_index(mp, order));
+   }
+   printf("\n");
+
+   if (mp->nr_nodes > 1)
+      MEMPHY_numa_stats(mp, name);
+}
+
+/*
+ *  MEMPHY_numa_stats - per node usage and local/remote CPU accesses
+ */
+void MEMPHY_numa_stats(struct memphy_struct *mp, const char *name)
+{
+   struct memphy_node *node;
+   unsigned long local = 0, remote = 0;
+   int it, fpn, used;
+
+   for (it = 0; it < mp->nr_nodes; it++) {
+      node = &mp->nodes[it];
+      used = 0;
+      for (fpn = node->start_fp; fpn < (int)(node->start_fp + node->nr_fp); fpn++)
+         if (mp->fp_bitmap[fpn / 64] & BIT_ULL(fpn % 64))
+            used++;
+      printf("[NUMA STATS] %s node %d: %d/%lu frames used | local %lu | remote %lu | fallback allocs %lu\n",
+             name, it, used, (unsigned long)node->nr_fp, node->nr_local,
+             node->nr_remote, node->nr_fallback);
+      local += node->nr_local;
+      remote += node->nr_remote;
+   }
+   printf("[NUMA STATS] %s remote access ratio: %.2f%% | access time %lu\n", name,
+          (local + remote > 0) ? 100.0 * remote / (local + remote) : 0.0,
+          mp->numa_time);
+}
+
+/*
+ *  MEMPHY_set_cost - cost model of a sequential device
+ *  @seek: time per page of head travel
+ *  @rot: rotational latency paid on every head move
+ *  @xfer: time to transfer one page
+ */
+void MEMPHY_set_cost(struct memphy_struct *mp, unsigned long seek,
+                     unsigned long rot, unsigned long xfer)
+{
+   mp->seek_cost = seek;
+   mp->rot_cost = rot;
+   mp->xfer_cost = xfer;
+   mp->io_time = 0;
+   mp->seek_dist = 0;
+   mp->nr_seek = 0;
+   mp->nr_io = 0;
+}
+
+/*
+ *  MEMPHY_take_io_time - device time spent by the calling thread since
+ *  the previous call
+ */
+unsigned long MEMPHY_take_io_time(void)
+{
+   unsigned long t = memphy_io_time;
+
+   memphy_io_time = 0;
+   return t;
+}
+
+void MEMPHY_set_cpu(int cpu)
+{
+   memphy_cpu = cpu;
+}
+
+/*
+ *  memphy_take_frame - allocate a frame of the shared pool
+ *  Next-fit: the search starts at the word of the last allocation and
+ *  takes the lowest free frame of the first non empty word. A device
+ *  with a buddy allocator hands out an order 0 block instead.
+ *  Called with memphy_lock held.
+ */
+static int memphy_take_frame(struct memphy_struct *mp, addr_t *retfpn)
+{
+   int iter, word;
+
+   if (mp->free_fp_cnt <= 0)
+      return -1;
+
+   if (mp->buddy_norder > 0)
+      return buddy_alloc(mp, 0, retfpn);
+
+   for (iter = 0; iter < mp->fp_nwords; iter++) {
+      word = (mp->fp_cursor + iter) % mp->fp_nwords;
+      if (mp->fp_bitmap[word] == ~0ULL)
+         continue;
+
+      *retfpn = (addr_t)word * 64 + __builtin_ctzll(~mp->fp_bitmap[word]);
+      mp->fp_bitmap[word] |= mp->fp_bitmap[word] + 1;
+      mp->fp_cursor = word;
+      mp->free_fp_cnt--;
+      return 0;
+   }
+
+   return -1;
+}
+
+/*
+ *  memphy_give_frame - release a frame to the shared pool
+ *  Called with memphy_lock held.
+ */
+static int memphy_give_frame(struct memphy_struct *mp, addr_t fpn)
+{
+   uint64_t mask = BIT_ULL(fpn % 64);
+
+   /* Already free, do not count it twice */
+   if (!(mp->fp_bitmap[fpn / 64] & mask))
+      return -1;
+
+   /* Held by a magazine, it is not in use either */
+   if (mp->fp_cached != NULL && __atomic_load_n(&mp->fp_cached[fpn], __ATOMIC_ACQUIRE))
+      return -1;
+
+   if (mp->buddy_norder > 0) {
+      buddy_free(mp, fpn);
+   } else {
+      mp->fp_bitmap[fpn / 64] &= ~mask;
+      mp->free_fp_cnt++;
+   }
+
    return 0;
 }
 
+/*
+ *  MEMPHY_mag_init - give each CPU a magazine of free frames
+ *  @mp: memphy struct
+ *  @ncpu: number of CPU threads
+ *
+ *  A magazine holds at most a quarter of the device frames split over the
+ *  CPUs, a device too small for that gets no magazine.
+ */
+int MEMPHY_mag_init(struct memphy_struct *mp, int ncpu)
+{
+   int numfp = mp->maxsz / PAGING_PAGESZ;
+   int magsz = MEMPHY_MAG_SIZE;
+
+   mp->nr_mags = 0;
+   if (ncpu <= 0)
+      return -1;
+   if (magsz > numfp / (4 * ncpu))
+      magsz = numfp / (4 * ncpu);
+   if (magsz < 2)
+      return -1;
+
+   mp->mags = calloc(ncpu, sizeof(struct memphy_mag));
+   mp->fp_cached = calloc(numfp, sizeof(unsigned char));
+   mp->mag_cached = 0;
+   mp->mag_size = magsz;
+   mp->nr_mags = ncpu;
+   return 0;
+}
+
+/*
+ *  mag_claim / mag_release - own a magazine without blocking. Its CPU
+ *  finds it free unless a thief is draining it, and then falls back to
+ *  the shared pool instead of waiting.
+ */
+static int mag_claim(struct memphy_mag *mag)
+{
+   return __atomic_exchange_n(&mag->busy, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static void mag_release(struct memphy_mag *mag)
+{
+   __atomic_store_n(&mag->busy, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *  mag_push / mag_pop - move a frame into or out of a magazine, the caller
+ *  has claimed it. A frame already cached somewhere is refused.
+ */
+static int mag_push(struct memphy_struct *mp, struct memphy_mag *mag, addr_t fpn)
+{
+   if (__atomic_exchange_n(&mp->fp_cached[fpn], 1, __ATOMIC_ACQ_REL))
+      return -1;
+
+   mag->fpn[mag->count++] = fpn;
+   __atomic_add_fetch(&mp->mag_cached, 1, __ATOMIC_RELAXED);
+   return 0;
+}
+
+static addr_t mag_pop(struct memphy_struct *mp, struct memphy_mag *mag)
+{
+   addr_t fpn = mag->fpn[--mag->count];
+
+   __atomic_store_n(&mp->fp_cached[fpn], 0, __ATOMIC_RELEASE);
+   __atomic_sub_fetch(&mp->mag_cached, 1, __ATOMIC_RELAXED);
+   return fpn;
+}
+
+/*
+ *  mag_steal - take a frame cached by any CPU once the shared pool is
+ *  empty, so that no frame sits idle while the pager reclaims
+ */
+static int mag_steal(struct memphy_struct *mp, addr_t *retfpn)
+{
+   struct memphy_mag *mag;
+   int cpu;
+
+   for (cpu = 0; cpu < mp->nr_mags; cpu++) {
+      mag = &mp->mags[cpu];
+      /* A magazine in use by its CPU is skipped */
+      if (!mag_claim(mag))
+         continue;
+      if (mag->count > 0) {
+         *retfpn = mag_pop(mp, mag);
+         mag_release(mag);
+         return 0;
+      }
+      mag_release(mag);
+   }
+   return -1;
+}
+
+/*
+ *  MEMPHY_nr_free - free frames of the device, the cached ones included
+ */
+int MEMPHY_nr_free(struct memphy_struct *mp)
+{
+   return mp->free_fp_cnt + __atomic_load_n(&mp->mag_cached, __ATOMIC_RELAXED);
+}
+
+/*
+ *  MEMPHY_get_freefp - allocate a free frame
+ *  A CPU thread takes it from its own magazine without any lock, an empty
+ *  magazine is refilled with half of its size in one locked batch. A
+ *  magazine being drained is bypassed for the shared pool. When the shared
+ *  pool is empty as well, the frames cached by the other CPUs are drained
+ *  before the caller reclaims.
+ */
+int MEMPHY_get_freefp(struct memphy_struct *mp, addr_t *retfpn)
+{
+   struct memphy_mag *mag;
+   int ret;
+
+   addr_t fpn;
+
+   if (memphy_cpu >= 0 && memphy_cpu < mp->nr_mags &&
+       mag_claim(mag = &mp->mags[memphy_cpu])) {
+      if (mag->count == 0) {
+         pthread_mutex_lock(&mp->memphy_lock);
+         while (mag->count < mp->mag_size / 2 &&
+                memphy_take_frame(mp, &fpn) == 0)
+            mag_push(mp, mag, fpn);
+         pthread_mutex_unlock(&mp->memphy_lock);
+      }
+
+      if (mag->count > 0) {
+         *retfpn = mag_pop(mp, mag);
+         mag_release(mag);
+         return 0;
+      }
+      mag_release(mag);
+      return mag_steal(mp, retfpn);
+   }
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   ret = memphy_take_frame(mp, retfpn);
+   pthread_mutex_unlock(&mp->memphy_lock);
+
+   if (ret != 0 && mp->nr_mags > 0)
+      ret = mag_steal(mp, retfpn);
+   return ret;
+}
+
 int MEMPHY_dump(struct memphy_struct *mp)
 {
   /*TODO dump memphy contnt mp->storage
    *     for tracing the memory content
    */
    printf("===== PHYSICAL MEMORY DUMP =====\n");
-   printf("masz : %d \n",mp->maxsz);
+   printf("masz : %lu \n",(unsigned long)mp->maxsz);
    uint32_t* word_storage = (uint32_t*)mp->storage;
-   int i;
+   addr_t i;
    for (i = 0; i < mp->maxsz / 4; i++){
+      /* Free frames are skipped so never used pages stay untouched */
+      if (i % (PAGING_PAGESZ / 4) == 0 && mp->fp_bitmap != NULL &&
+          !(mp->fp_bitmap[i / (PAGING_PAGESZ / 4) / 64] & BIT_ULL(i / (PAGING_PAGESZ / 4) % 64))) {
+         i += PAGING_PAGESZ / 4 - 1;
+         continue;
+      }
       if (word_storage[i] != 0)
-      printf("BYTE %08x: %d\n", i * 4, word_storage[i]);
+      printf("BYTE %08lx: %d\n", (unsigned long)i * 4, word_storage[i]);
 	}
    printf("===== PHYSICAL MEMORY END-DUMP =====\n");
    
    return 0;
 }
 
+/*
+ *  MEMPHY_put_freefp - release a frame
+ *  A CPU thread keeps it in its magazine without any lock, a full magazine
+ *  gives half of its frames back to the shared pool in one locked batch.
+ */
 int MEMPHY_put_freefp(struct memphy_struct *mp, addr_t fpn)
 {
-   pthread_mutex_lock(&mp->memphy_lock);
+   struct memphy_mag *mag;
+   int ret;
 
-   struct framephy_struct *fp = mp->free_fp_list;
-   struct framephy_struct *newnode = malloc(sizeof(struct framephy_struct));
+   if (fpn >= mp->maxsz / PAGING_PAGESZ)
+      return -1;
 
-   /* Create new node with value fpn */
-   newnode->fpn = fpn;
-   newnode->fp_next = fp;
-   mp->free_fp_list = newnode;
+   /* A frame of another node would be handed out as a local one later */
+   if (memphy_cpu >= 0 && memphy_cpu < mp->nr_mags &&
+       (mp->nr_nodes <= 1 || memphy_node_of(mp, fpn) == memphy_cpu_node(mp))) {
+      /* Only a frame in use may be cached, a free one would be handed out twice */
+      if (!(__atomic_load_n(&mp->fp_bitmap[fpn / 64], __ATOMIC_RELAXED) & BIT_ULL(fpn % 64)))
+         return -1;
 
+      mag = &mp->mags[memphy_cpu];
+      if (mag_claim(mag)) {
+         if (mag->count == mp->mag_size) {
+            pthread_mutex_lock(&mp->memphy_lock);
+            while (mag->count > mp->mag_size / 2)
+               memphy_give_frame(mp, mag_pop(mp, mag));
+            pthread_mutex_unlock(&mp->memphy_lock);
+         }
+
+         ret = mag_push(mp, mag, fpn);
+         mag_release(mag);
+         return ret;
+      }
+   }
+
+   pthread_mutex_lock(&mp->memphy_lock);
+   ret = memphy_give_frame(mp, fpn);
    pthread_mutex_unlock(&mp->memphy_lock);
 
+   return ret;
+}
+
+/*
+ *  memphy_map_storage - map the storage of a MEMPHY device
+ *  @mp: memphy struct, maxsz already set
+ *  @path: host file for MEMPHY_BACK_FILE
+ *
+ *  Mapped storage is reserved only, host pages are allocated on first
+ *  touch. A file device is extended sparsely and keeps its content after
+ *  the run.
+ */
+static int memphy_map_storage(struct memphy_struct *mp, const char *path)
+{
+   void *addr;
+
+   if (mp->maxsz == 0) {
+      mp->storage = NULL;
+      return 0;
+   }
+
+   if (mp->backing == MEMPHY_BACK_ANON) {
+      addr = mmap(NULL, mp->maxsz, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+   } else {
+      mp->fd = open(path, O_RDWR | O_CREAT, 0644);
+      if (mp->fd < 0) {
+         perror(path);
+         return -1;
+      }
+      if (ftruncate(mp->fd, mp->maxsz) < 0) {
+         perror(path);
+         close(mp->fd);
+         mp->fd = -1;
+         return -1;
+      }
+      addr = mmap(NULL, mp->maxsz, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_NORESERVE, mp->fd, 0);
+   }
+
+   if (addr == MAP_FAILED) {
+      perror("mmap");
+      if (mp->fd >= 0)
+         close(mp->fd);
+      mp->fd = -1;
+      return -1;
+   }
+
+   mp->storage = (BYTE *)addr;
    return 0;
 }
 
@@ -222,16 +1090,42 @@ int MEMPHY_put_freefp(struct memphy_struct *mp, addr_t fpn)
  */
 int init_memphy(struct memphy_struct *mp, addr_t max_size, int randomflg)
 {
-   mp->storage = (BYTE *)malloc(max_size * sizeof(BYTE));
+   return init_memphy_backed(mp, max_size, randomflg, MEMPHY_BACK_HEAP, NULL);
+}
+
+/*
+ *  init_memphy_backed - init MEMPHY struct on a given host backing
+ *  @mp: memphy struct
+ *  @max_size: device size in bytes
+ *  @randomflg: random access device
+ *  @backing: MEMPHY_BACK_HEAP, MEMPHY_BACK_ANON or MEMPHY_BACK_FILE
+ *  @path: host file for MEMPHY_BACK_FILE
+ */
+int init_memphy_backed(struct memphy_struct *mp, addr_t max_size, int randomflg,
+                       int backing, const char *path)
+{
    mp->maxsz = max_size;
-   memset(mp->storage, 0, max_size * sizeof(BYTE));
+   mp->backing = backing;
+   mp->fd = -1;
+
+   if (backing == MEMPHY_BACK_HEAP) {
+      /* Large blocks come zero filled from the host on first touch */
+      mp->storage = (BYTE *)calloc(max_size, sizeof(BYTE));
+   } else if (memphy_map_storage(mp, path) < 0) {
+      return -1;
+   }
 
    MEMPHY_format(mp, PAGING_PAGESZ);
 
    mp->rdmflg = (randomflg != 0) ? 1 : 0;
 
-   if (!mp->rdmflg) /* Not Ramdom acess device, then it serial device*/
-      mp->cursor = 0;
+   /* Head of a sequential device starts at the beginning, no cost */
+   mp->cursor = 0;
+   MEMPHY_set_cost(mp, 0, 0, 0);
+
+   mp->swp_class = 0;
+   mp->swp_prio = 0;
+   mp->iosched = IOSCHED_FCFS;
    
    // Khởi tạo mutex_lock
    pthread_mutex_init(&mp->memphy_lock, NULL);
@@ -239,4 +1133,46 @@ int init_memphy(struct memphy_struct *mp, addr_t max_size, int randomflg)
    return 0;
 }
 
+/*
+ *  release_memphy - release the storage of a MEMPHY device
+ *  A file backed device is flushed to its host file first.
+ */
+int release_memphy(struct memphy_struct *mp)
+{
+   if (mp->backing == MEMPHY_BACK_HEAP) {
+      free(mp->storage);
+   } else if (mp->storage != NULL) {
+      if (mp->backing == MEMPHY_BACK_FILE)
+         msync(mp->storage, mp->maxsz, MS_SYNC);
+      munmap(mp->storage, mp->maxsz);
+   }
+   mp->storage = NULL;
+
+   free(mp->fp_bitmap);
+   mp->fp_bitmap = NULL;
+   if (mp->buddy_norder > 0) {
+      free(mp->buddy_head);
+      free(mp->buddy_next);
+      free(mp->buddy_prev);
+      free(mp->buddy_blk);
+      mp->buddy_norder = 0;
+   }
+   if (mp->nr_mags > 0) {
+      free(mp->mags);
+      free(mp->fp_cached);
+      mp->fp_cached = NULL;
+      mp->nr_mags = 0;
+   }
+   if (mp->nr_nodes > 1) {
+      free(mp->nodes);
+      mp->nr_nodes = 1;
+   }
+
+   if (mp->fd >= 0)
+      close(mp->fd);
+   mp->fd = -1;
+
+   return 0;
+}
+
 // #endif
\ No newline at end of file
@@ -0,0 +1,860 @@
+/*
+ * PAGING based Memory Management
+ * Swap management module mm/mm-swap.c
+ *
+ * Swap slots over tiered swap devices, victim swap-out shared by the
+ * page fault path and the background page-out daemon (kswapd), swap-in
+ * readahead, cold page demotion to slower swap tiers and the swap I/O
+ * worker serving swap-in faults of blocked processes.
+ */
+
+#include "../include/mm64.h"
+#include "../include/libmem.h"
+#include "../include/os-sched.h"
+#include "../include/timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* Swap statistics, printed by swap_print_stats() on shutdown */
+static unsigned long pgswapout_cnt = 0;
+static unsigned long swapin_fault_cnt = 0;
+static unsigned long ra_issued_cnt = 0;
+static unsigned long ra_hit_cnt = 0;
+static unsigned long demote_cnt = 0;
+static unsigned long hot_keep_cnt = 0;
+static unsigned long swapio_cnt = 0;
+static unsigned long swapio_slots = 0;
+
+static int swap_ra_max = SWAP_RA_MAX;
+
+/*
+ * Reverse map of a swap slot, used to fix up the owner PTE when the
+ * slot content is migrated to another device.
+ */
+struct swap_rmap_struct {
+  struct pcb_t *owner;
+  addr_t pgn;
+};
+
+static struct swap_rmap_struct *swap_rmap[PAGING_MAX_MMSWP];
+
+/* Non-empty swap devices, fastest class first then highest priority */
+static int swap_order[PAGING_MAX_MMSWP];
+static int nr_swap_dev = 0;
+static int nr_swap_tier = 0;
+
+/* Per device demotion scan cursor */
+static addr_t swap_scan[PAGING_MAX_MMSWP];
+
+/* ========================================================================= */
+/* SWAP DEVICES AND SLOTS                                                    */
+/* ========================================================================= */
+
+static int swap_dev_before(struct memphy_struct *a, struct memphy_struct *b)
+{
+  if (a->swp_class != b->swp_class)
+    return a->swp_class < b->swp_class;
+  return a->swp_prio > b->swp_prio;
+}
+
+/*
+ * swap_init - order the swap devices by tier and set up their reverse maps
+ * @krnl: kernel, swap devices initialized with their class and priority
+ */
+int swap_init(struct krnl_t *krnl)
+{
+  int id, it, numslot;
+
+  nr_swap_dev = 0;
+  nr_swap_tier = 0;
+
+  for (id = 0; id < PAGING_MAX_MMSWP; id++) {
+    numslot = krnl->mswp[id]->maxsz / PAGING_PAGESZ;
+    swap_scan[id] = 0;
+    if (numslot <= 0)
+      continue;
+
+    swap_rmap[id] = calloc(numslot, sizeof(struct swap_rmap_struct));
+
+    /* Insertion sort, keeps device id order inside a tier */
+    it = nr_swap_dev++;
+    while (it > 0 && swap_dev_before(krnl->mswp[id], krnl->mswp[swap_order[it - 1]])) {
+      swap_order[it] = swap_order[it - 1];
+      it--;
+    }
+    swap_order[it] = id;
+  }
+
+  for (it = 0; it < nr_swap_dev; it++)
+    if (it == 0 || krnl->mswp[swap_order[it]]->swp_class !=
+                   krnl->mswp[swap_order[it - 1]]->swp_class)
+      nr_swap_tier++;
+
+  return 0;
+}
+
+/*
+ * swap_get_slot_from - allocate a slot from swap_order[first..]
+ * Devices sharing the same class and priority are used round-robin.
+ */
+static int swap_get_slot_from(struct krnl_t *krnl, int first, int *swptyp, addr_t *swpoff)
+{
+  int grp, gend, nr, start, it, id;
+  struct memphy_struct *mp;
+
+  for (grp = first; grp < nr_swap_dev; grp = gend) {
+    mp = krnl->mswp[swap_order[grp]];
+    gend = grp + 1;
+    while (gend < nr_swap_dev &&
+           krnl->mswp[swap_order[gend]]->swp_class == mp->swp_class &&
+           krnl->mswp[swap_order[gend]]->swp_prio == mp->swp_prio)
+      gend++;
+
+    /* Continue after the device which served the last slot */
+    nr = gend - grp;
+    start = 0;
+    for (it = 0; it < nr; it++)
+      if (swap_order[grp + it] == (int)krnl->active_mswp_id)
+        start = it + 1;
+
+    for (it = 0; it < nr; it++) {
+      id = swap_order[grp + (start + it) % nr];
+      if (krnl->mswp[id]->free_fp_cnt <= 0)
+        continue;
+
+      if (MEMPHY_get_freefp(krnl->mswp[id], swpoff) == 0) {
+        krnl->active_mswp_id = id;
+        krnl->active_mswp = krnl->mswp[id];
+        *swptyp = id;
+        return 0;
+      }
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * swap_get_slot - allocate a swap slot
+ * @krnl: kernel
+ * @swptyp: swap device index (PTE SWPTYP field)
+ * @swpoff: slot on that device (PTE SWPOFF field)
+ *
+ * The slot comes from the fastest tier with free space and is striped over
+ * the devices of equal priority in that tier, krnl->active_mswp tracks the
+ * device which served the last slot. Caller must hold krnl->mm->mm_lock.
+ */
+int swap_get_slot(struct krnl_t *krnl, int *swptyp, addr_t *swpoff)
+{
+  return swap_get_slot_from(krnl, 0, swptyp, swpoff);
+}
+
+/*
+ * swap_put_slot - release the swap slot recorded in a swapped PTE
+ */
+int swap_put_slot(struct krnl_t *krnl, int swptyp, addr_t swpoff)
+{
+  if (swptyp < 0 || swptyp >= PAGING_MAX_MMSWP || swap_rmap[swptyp] == NULL)
+    return -1;
+
+  swap_rmap[swptyp][swpoff].owner = NULL;
+  return MEMPHY_put_freefp(krnl->mswp[swptyp], swpoff);
+}
+
+/*
+ * swap_set_owner - record the page now holding the content of a slot
+ */
+void swap_set_owner(int swptyp, addr_t swpoff, struct pcb_t *owner, addr_t pgn)
+{
+  if (swptyp < 0 || swptyp >= PAGING_MAX_MMSWP || swap_rmap[swptyp] == NULL)
+    return;
+
+  swap_rmap[swptyp][swpoff].owner = owner;
+  swap_rmap[swptyp][swpoff].pgn = pgn;
+}
+
+/*
+ * swap_in_page - bring a swapped page into a MEMRAM frame
+ * @caller: owner of the page
+ * @pgn: page number
+ * @pte: swapped PTE of the page
+ * @fpn: destination MEMRAM frame
+ * @ra: the page is brought in by readahead, not by a fault
+ *
+ * The swap slot is released and the PTE mapped to @fpn. A faulted page gets
+ * its swap-in counter raised, hot pages are kept on the fast swap tier.
+ */
+int swap_in_page(struct pcb_t *caller, addr_t pgn, uint32_t pte, addr_t fpn, int ra)
+{
+  struct krnl_t *krnl = caller->krnl;
+  int swptyp = PAGING_PTE_SWPTYP(pte);
+  addr_t swpoff = PAGING_SWP(pte);
+  uint32_t swpcnt = PAGING_PTE_SWPCNT(pte);
+
+  if (swptyp >= PAGING_MAX_MMSWP)
+    return -1;
+
+  __swap_cp_page(krnl->mswp[swptyp], swpoff, krnl->mram, fpn);
+  swap_put_slot(krnl, swptyp, swpoff);
+
+  pte_set_fpn(caller, pgn, fpn);
+  pte = pte_get_entry(caller, pgn);
+  if (ra)
+    pte |= PAGING_PTE_READAHEAD_MASK;
+  else if (swpcnt < PAGING_PTE_SWPCNT_MAX)
+    SETVAL(pte, (swpcnt + 1), PAGING_PTE_SWPCNT_MASK, PAGING_PTE_SWPCNT_LOBIT);
+  pte_set_entry(caller, pgn, pte);
+
+  return 0;
+}
+
+/* ========================================================================= */
+/* VICTIM SWAP OUT                                                           */
+/* ========================================================================= */
+
+/*
+ * swap_out_page - evict one page of the global FIFO to a swap device
+ * @krnl: kernel
+ * @retfpn: MEMRAM frame released by the victim
+ *
+ * Caller must hold krnl->mm->mm_lock. Stale FIFO entries (pages freed or
+ * already swapped out) are skipped.
+ */
+int swap_out_page(struct krnl_t *krnl, addr_t *retfpn)
+{
+  int vicpgn;
+  struct pcb_t *vic_owner;
+  uint32_t vicpte;
+  addr_t vicfpn, swpoff;
+  int swptyp;
+
+  do {
+    if (find_victim_page(krnl->mm, &vicpgn, &vic_owner) < 0)
+      return -1;
+
+    vicpte = pte_get_entry(vic_owner, vicpgn);
+  } while (!(vicpte & PAGING_PTE_PRESENT_MASK));
+
+  vicfpn = PAGING_FPN(vicpte);
+
+  if (swap_get_slot(krnl, &swptyp, &swpoff) < 0) {
+    printf("[ERROR] SWAP device is also full!\n");
+    /* Keep the victim eligible for the next attempt */
+    enlist_pgn_node(&krnl->mm->fifo_pgn, vicpgn, vic_owner);
+    return -1;
+  }
+
+  /* The frame is about to be taken away, drop cached translation */
+  tlb_clear_entry(vic_owner->pid, vicpgn);
+
+  __swap_cp_page(krnl->mram, vicfpn, krnl->mswp[swptyp], swpoff);
+  pte_set_swap(vic_owner, vicpgn, swptyp, swpoff);
+
+  swap_rmap[swptyp][swpoff].owner = vic_owner;
+  swap_rmap[swptyp][swpoff].pgn = vicpgn;
+
+  printf("[SWAP OUT] Victim: PID %d, PGN %d | RAM[%ld] -> SWAP%d[%ld]\n",
+         vic_owner->pid, vicpgn, vicfpn, swptyp, swpoff);
+
+  pgswapout_cnt++;
+  *retfpn = vicfpn;
+  return 0;
+}
+
+/* ========================================================================= */
+/* SWAP-IN READAHEAD                                                         */
+/* ========================================================================= */
+
+void swap_set_readahead(int ramax)
+{
+  swap_ra_max = (ramax < 0) ? 0 : ramax;
+}
+
+/*
+ * swap_readahead - bring in the swapped-out pages that follow @pgn
+ * @caller: process which took the swap-in fault on @pgn
+ * @pgn: faulting page, already swapped in
+ *
+ * Only free MEMRAM frames are used, readahead never evicts. The window is
+ * doubled when at least half of the previous batch got accessed and halved
+ * otherwise. Caller must hold krnl->mm->mm_lock.
+ */
+int swap_readahead(struct pcb_t *caller, addr_t pgn)
+{
+  struct mm_struct *mm = caller->mm;
+  struct krnl_t *krnl = caller->krnl;
+  addr_t npgn, fpn;
+  uint32_t pte;
+  int nr = 0;
+
+  swapin_fault_cnt++;
+  if (swap_ra_max == 0)
+    return 0;
+
+  if (mm->ra_size > 0) {
+    if (2 * mm->ra_hit >= mm->ra_size)
+      mm->ra_window *= 2;
+    else if (mm->ra_window > 1)
+      mm->ra_window /= 2;
+  }
+  if (mm->ra_window > swap_ra_max)
+    mm->ra_window = swap_ra_max;
+
+  for (npgn = pgn + 1; nr < mm->ra_window; npgn++, nr++) {
+    pte = pte_get_entry(caller, npgn);
+    if (!(pte & PAGING_PTE_SWAPPED_MASK) || (pte & PAGING_PTE_PRESENT_MASK))
+      break;
+
+    if (MEMPHY_get_freefp(krnl->mram, &fpn) < 0)
+      break;
+
+    swap_in_page(caller, npgn, pte, fpn, 1);
+    enlist_pgn_node(&krnl->mm->fifo_pgn, npgn, caller);
+  }
+
+  mm->ra_size = nr;
+  mm->ra_hit = 0;
+  ra_issued_cnt += nr;
+
+  if (nr > 0)
+    kswapd_wakeup(krnl);
+
+  return nr;
+}
+
+/*
+ * swap_readahead_hit - first access to a page brought in by readahead
+ */
+void swap_readahead_hit(struct pcb_t *caller, addr_t pgn, uint32_t pte)
+{
+  pte_set_entry(caller, pgn, pte & ~PAGING_PTE_READAHEAD_MASK);
+  caller->mm->ra_hit++;
+  ra_hit_cnt++;
+}
+
+/* ========================================================================= */
+/* TIERED SWAP - COLD PAGE DEMOTION                                          */
+/* ========================================================================= */
+
+/*
+ * swap_demote_slot - move the page in slot @off of device @id to a device
+ * of swap_order[lower..]
+ *
+ * A hot page (swap-in counter not zero) gets a second chance instead: the
+ * counter is decremented and the page stays put. Caller must hold
+ * krnl->mm->mm_lock.
+ */
+static int swap_demote_slot(struct krnl_t *krnl, int id, addr_t off, int lower)
+{
+  struct swap_rmap_struct *rmap = &swap_rmap[id][off];
+  uint32_t pte, swpcnt;
+  addr_t newoff;
+  int newtyp;
+
+  if (rmap->owner == NULL)
+    return -1;
+
+  pte = pte_get_entry(rmap->owner, rmap->pgn);
+  if (!(pte & PAGING_PTE_SWAPPED_MASK) || (pte & PAGING_PTE_PRESENT_MASK) ||
+      PAGING_PTE_SWPTYP(pte) != id || PAGING_SWP(pte) != off)
+    return -1;
+
+  swpcnt = PAGING_PTE_SWPCNT(pte);
+  if (swpcnt > 0) {
+    SETVAL(pte, (swpcnt - 1), PAGING_PTE_SWPCNT_MASK, PAGING_PTE_SWPCNT_LOBIT);
+    pte_set_entry(rmap->owner, rmap->pgn, pte);
+    hot_keep_cnt++;
+    return -1;
+  }
+
+  if (swap_get_slot_from(krnl, lower, &newtyp, &newoff) < 0)
+    return -1;
+
+  MEMPHY_copy_frame(krnl->mswp[id], off, krnl->mswp[newtyp], newoff);
+  pte_set_swap(rmap->owner, rmap->pgn, newtyp, newoff);
+
+  swap_rmap[newtyp][newoff] = *rmap;
+  swap_put_slot(krnl, id, off);
+
+  demote_cnt++;
+  return 0;
+}
+
+/*
+ * swap_demote - migrate cold pages off the nearly full fast swap tiers
+ * Up to SWAP_DEMOTE_BATCH pages per device are moved in one round.
+ */
+static void swap_demote(struct krnl_t *krnl)
+{
+  struct memphy_struct *mp;
+  int it, lower, id, numslot, scanned, moved;
+
+  for (it = 0; it < nr_swap_dev; it++) {
+    id = swap_order[it];
+    mp = krnl->mswp[id];
+    numslot = mp->maxsz / PAGING_PAGESZ;
+
+    /* First device of a slower class */
+    for (lower = it + 1; lower < nr_swap_dev; lower++)
+      if (krnl->mswp[swap_order[lower]]->swp_class > mp->swp_class)
+        break;
+    if (lower >= nr_swap_dev)
+      break;
+
+    moved = 0;
+    for (scanned = 0; scanned < numslot && moved < SWAP_DEMOTE_BATCH; scanned++) {
+      if ((numslot - mp->free_fp_cnt) * 100 < numslot * SWAP_TIER_FULL)
+        break;
+
+      pthread_mutex_lock(&krnl->mm->mm_lock);
+      if (swap_demote_slot(krnl, id, swap_scan[id], lower) == 0)
+        moved++;
+      pthread_mutex_unlock(&krnl->mm->mm_lock);
+
+      swap_scan[id] = (swap_scan[id] + 1) % numslot;
+    }
+  }
+}
+
+/* ========================================================================= */
+/* KSWAPD - BACKGROUND PAGE-OUT DAEMON                                       */
+/* ========================================================================= */
+
+static struct {
+  struct krnl_t *krnl;
+  pthread_t tid;
+  pthread_mutex_t lock;
+  pthread_cond_t wait;
+  int running;
+  int pending;
+
+  /* Watermarks in number of free MEMRAM frames */
+  int wmark_low;
+  int wmark_high;
+
+  unsigned long nr_wakeup;
+  unsigned long nr_reclaim;
+} kswapd;
+
+/*
+ * kswapd_balance - swap out pages until the high watermark is reached
+ * The kernel mm lock is taken per page so faulting CPUs are not starved.
+ */
+static void kswapd_balance(struct krnl_t *krnl)
+{
+  addr_t fpn;
+
+  while (MEMPHY_nr_free(krnl->mram) < kswapd.wmark_high) {
+    pthread_mutex_lock(&krnl->mm->mm_lock);
+
+    if (MEMPHY_nr_free(krnl->mram) >= kswapd.wmark_high ||
+        swap_out_page(krnl, &fpn) < 0) {
+      pthread_mutex_unlock(&krnl->mm->mm_lock);
+      break;
+    }
+    MEMPHY_put_freefp(krnl->mram, fpn);
+    kswapd.nr_reclaim++;
+
+    pthread_mutex_unlock(&krnl->mm->mm_lock);
+  }
+}
+
+/*
+ * kswapd_wait - sleep until kicked, with several swap tiers also wake up
+ * every SWAP_DEMOTE_MS to run a demotion round
+ */
+static void kswapd_wait(void)
+{
+  struct timespec ts;
+
+  if (nr_swap_tier <= 1) {
+    while (!kswapd.pending && kswapd.running)
+      pthread_cond_wait(&kswapd.wait, &kswapd.lock);
+    return;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += SWAP_DEMOTE_MS * 1000000L;
+  ts.tv_sec += ts.tv_nsec / 1000000000L;
+  ts.tv_nsec %= 1000000000L;
+
+  while (!kswapd.pending && kswapd.running)
+    if (pthread_cond_timedwait(&kswapd.wait, &kswapd.lock, &ts) == ETIMEDOUT)
+      break;
+}
+
+static void *kswapd_routine(void *args)
+{
+  struct krnl_t *krnl = (struct krnl_t *)args;
+  int balance;
+
+  pthread_mutex_lock(&kswapd.lock);
+  while (kswapd.running) {
+    kswapd_wait();
+
+    if (!kswapd.running)
+      break;
+
+    balance = kswapd.pending;
+    if (balance) {
+      kswapd.pending = 0;
+      kswapd.nr_wakeup++;
+    }
+    pthread_mutex_unlock(&kswapd.lock);
+
+    if (krnl->mm != NULL) {
+      if (balance)
+        kswapd_balance(krnl);
+      if (nr_swap_tier > 1)
+        swap_demote(krnl);
+    }
+
+    pthread_mutex_lock(&kswapd.lock);
+  }
+  pthread_mutex_unlock(&kswapd.lock);
+
+  pthread_exit(NULL);
+}
+
+/*
+ * kswapd_start - spawn the page-out daemon
+ * @krnl: kernel, its mram must already be initialized and swap_init() done
+ * @lowpct: low watermark in percent of MEMRAM frames
+ * @highpct: high watermark in percent of MEMRAM frames
+ */
+int kswapd_start(struct krnl_t *krnl, int lowpct, int highpct)
+{
+  int numfp = krnl->mram->maxsz / PAGING_PAGESZ;
+
+  kswapd.krnl = krnl;
+  kswapd.wmark_low = numfp * lowpct / 100;
+  kswapd.wmark_high = numfp * highpct / 100;
+  if (kswapd.wmark_high < kswapd.wmark_low)
+    kswapd.wmark_high = kswapd.wmark_low;
+
+  /* Too small RAM to keep any reserve and no slow tier to demote to */
+  if (kswapd.wmark_low <= 0 && nr_swap_tier <= 1)
+    return 0;
+
+  pthread_mutex_init(&kswapd.lock, NULL);
+  pthread_cond_init(&kswapd.wait, NULL);
+  kswapd.pending = 0;
+  kswapd.running = 1;
+
+  return pthread_create(&kswapd.tid, NULL, kswapd_routine, (void *)krnl);
+}
+
+/*
+ * kswapd_wakeup - kick the daemon when MEMRAM runs below the low watermark
+ */
+void kswapd_wakeup(struct krnl_t *krnl)
+{
+  if (!kswapd.running || MEMPHY_nr_free(krnl->mram) >= kswapd.wmark_low)
+    return;
+
+  pthread_mutex_lock(&kswapd.lock);
+  kswapd.pending = 1;
+  pthread_cond_signal(&kswapd.wait);
+  pthread_mutex_unlock(&kswapd.lock);
+}
+
+void kswapd_stop(void)
+{
+  if (!kswapd.running)
+    return;
+
+  pthread_mutex_lock(&kswapd.lock);
+  kswapd.running = 0;
+  pthread_cond_signal(&kswapd.wait);
+  pthread_mutex_unlock(&kswapd.lock);
+
+  pthread_join(kswapd.tid, NULL);
+}
+
+/* ========================================================================= */
+/* SWAP I/O WORKER - ASYNCHRONOUS SWAP-IN                                    */
+/* ========================================================================= */
+
+struct swapio_req {
+  struct pcb_t *proc;
+  int swptyp;
+  addr_t swpoff;
+  unsigned long submit; /* worker clock when queued */
+  struct swapio_req *next;
+};
+
+static struct {
+  struct krnl_t *krnl;
+  pthread_t tid;
+  pthread_mutex_t lock;
+  pthread_cond_t wait;
+  int running;
+  struct swapio_req *head;
+  struct swapio_req *tail;
+  unsigned long clock; /* device time spent by the worker */
+} swapio;
+
+/* Set on the worker thread, its own faults are served synchronously */
+static __thread int swapio_worker = 0;
+
+/* I/O scheduler policies, indexed by IOSCHED_* */
+static const char *iosched_name[] = {"fcfs", "sstf", "scan", "clook", "deadline"};
+
+/* Per swap device: SCAN direction and served requests statistics */
+static int iosched_up[PAGING_MAX_MMSWP];
+static unsigned long iosched_nr[PAGING_MAX_MMSWP];
+static unsigned long iosched_seek[PAGING_MAX_MMSWP];
+static unsigned long iosched_lat[PAGING_MAX_MMSWP];
+
+/*
+ * swap_iosched_id - IOSCHED_* policy of @name, -1 when unknown
+ */
+int swap_iosched_id(const char *name)
+{
+  int it;
+
+  for (it = 0; it < IOSCHED_NR; it++)
+    if (!strcmp(name, iosched_name[it]))
+      return it;
+  return -1;
+}
+
+/*
+ * swap_io_async - tell whether a swap-in fault is to be handed off to
+ * the swap I/O worker
+ */
+int swap_io_async(void)
+{
+  return swapio.running && !swapio_worker;
+}
+
+/*
+ * swap_io_submit - queue the swap-in of @proc->mm->swapio_pgn
+ * @proc must already be blocked, the worker wakes it up when done.
+ */
+void swap_io_submit(struct pcb_t *proc)
+{
+  struct swapio_req *req = malloc(sizeof(struct swapio_req));
+  uint32_t pte = pte_get_entry(proc, proc->mm->swapio_pgn);
+
+  req->proc = proc;
+  req->swptyp = PAGING_PTE_SWPTYP(pte);
+  req->swpoff = PAGING_SWP(pte);
+  req->next = NULL;
+
+  pthread_mutex_lock(&swapio.lock);
+  req->submit = swapio.clock;
+  if (swapio.tail != NULL)
+    swapio.tail->next = req;
+  else
+    swapio.head = req;
+  swapio.tail = req;
+  pthread_cond_signal(&swapio.wait);
+  pthread_mutex_unlock(&swapio.lock);
+}
+
+/*
+ * swap_io_pick - dequeue the next request to serve
+ *
+ * The device of the oldest request is served next, its own policy picks
+ * among the requests queued for it, measured from the current head slot:
+ * FCFS the oldest, SSTF the nearest, SCAN the nearest in the sweep
+ * direction (turning at the last request), C-LOOK the nearest at or
+ * above the head then wrapping to the lowest, DEADLINE as C-LOOK unless
+ * the oldest request waited IOSCHED_EXPIRE. Called with swapio.lock held.
+ */
+static struct swapio_req *swap_io_pick(void)
+{
+  struct swapio_req *req, *prev, *best = swapio.head, *bestprev = NULL;
+  struct memphy_struct *mp;
+  int dev = swapio.head->swptyp;
+  int policy;
+  addr_t head, nslot, key, bestkey = 0;
+
+  if (dev < PAGING_MAX_MMSWP) {
+    mp = swapio.krnl->mswp[dev];
+    policy = mp->iosched;
+    head = mp->cursor / PAGING_PAGESZ;
+    nslot = mp->maxsz / PAGING_PAGESZ;
+
+    if (policy == IOSCHED_DEADLINE)
+      policy = (swapio.clock - swapio.head->submit >= IOSCHED_EXPIRE) ?
+               IOSCHED_FCFS : IOSCHED_CLOOK;
+
+    for (prev = NULL, req = swapio.head; policy != IOSCHED_FCFS && req != NULL;
+         prev = req, req = req->next) {
+      if (req->swptyp != dev)
+        continue;
+
+      if (policy == IOSCHED_SSTF)
+        key = (req->swpoff >= head) ? req->swpoff - head : head - req->swpoff;
+      else if (policy == IOSCHED_SCAN && !iosched_up[dev])
+        key = (req->swpoff <= head) ? head - req->swpoff : nslot + req->swpoff - head;
+      else if (policy == IOSCHED_SCAN)
+        key = (req->swpoff >= head) ? req->swpoff - head : nslot + head - req->swpoff;
+      else
+        key = (req->swpoff >= head) ? req->swpoff - head : nslot + req->swpoff;
+
+      if (req == swapio.head || key < bestkey) {
+        best = req;
+        bestprev = prev;
+        bestkey = key;
+      }
+    }
+
+    if (policy == IOSCHED_SCAN && best->swpoff != head)
+      iosched_up[dev] = (best->swpoff > head);
+  }
+
+  if (bestprev != NULL)
+    bestprev->next = best->next;
+  else
+    swapio.head = best->next;
+  if (swapio.tail == best)
+    swapio.tail = bestprev;
+
+  return best;
+}
+
+/*
+ * swap_io_delay - let the time slots covering @iotime go by
+ */
+static void swap_io_delay(unsigned long iotime)
+{
+  uint64_t until;
+
+  if (iotime == 0)
+    return;
+
+  until = current_time() + (iotime + SEQDEV_SLOT_TIME - 1) / SEQDEV_SLOT_TIME;
+  swapio_slots += until - current_time();
+  while (current_time() < until && swapio.running)
+    usleep(100);
+}
+
+static void *swapio_routine(void *args)
+{
+  struct krnl_t *krnl = (struct krnl_t *)args;
+  struct swapio_req *req;
+  struct pcb_t *proc;
+  unsigned long iotime;
+  addr_t head, seek = 0;
+  int fpn;
+
+  swapio_worker = 1;
+
+  pthread_mutex_lock(&swapio.lock);
+  while (1) {
+    while (swapio.head == NULL && swapio.running)
+      pthread_cond_wait(&swapio.wait, &swapio.lock);
+
+    if (swapio.head == NULL)
+      break;
+
+    req = swap_io_pick();
+    pthread_mutex_unlock(&swapio.lock);
+
+    proc = req->proc;
+    if (req->swptyp < PAGING_MAX_MMSWP) {
+      head = krnl->mswp[req->swptyp]->cursor / PAGING_PAGESZ;
+      seek = (req->swpoff >= head) ? req->swpoff - head : head - req->swpoff;
+    }
+
+    MEMPHY_take_io_time();
+    pthread_mutex_lock(&krnl->mm->mm_lock);
+    pg_getpage(proc->mm, proc->mm->swapio_pgn, &fpn, proc);
+    swapio_cnt++;
+    pthread_mutex_unlock(&krnl->mm->mm_lock);
+
+    /* Keep the process blocked for the device time of its swap-in */
+    iotime = MEMPHY_take_io_time();
+    swap_io_delay(iotime);
+
+    wake_proc(proc);
+
+    pthread_mutex_lock(&swapio.lock);
+    swapio.clock += iotime;
+    if (req->swptyp < PAGING_MAX_MMSWP) {
+      iosched_nr[req->swptyp]++;
+      iosched_seek[req->swptyp] += seek;
+      iosched_lat[req->swptyp] += swapio.clock - req->submit;
+    }
+    free(req);
+  }
+  pthread_mutex_unlock(&swapio.lock);
+
+  pthread_exit(NULL);
+}
+
+/*
+ * swap_io_start - spawn the swap I/O worker
+ */
+int swap_io_start(struct krnl_t *krnl)
+{
+  swapio.krnl = krnl;
+  swapio.head = NULL;
+  swapio.tail = NULL;
+  swapio.clock = 0;
+  pthread_mutex_init(&swapio.lock, NULL);
+  pthread_cond_init(&swapio.wait, NULL);
+  swapio.running = 1;
+
+  return pthread_create(&swapio.tid, NULL, swapio_routine, (void *)krnl);
+}
+
+/*
+ * swap_io_stop - stop the worker once the queued requests are served
+ */
+void swap_io_stop(void)
+{
+  if (!swapio.running)
+    return;
+
+  pthread_mutex_lock(&swapio.lock);
+  swapio.running = 0;
+  pthread_cond_signal(&swapio.wait);
+  pthread_mutex_unlock(&swapio.lock);
+
+  pthread_join(swapio.tid, NULL);
+}
+
+void swap_print_stats(struct krnl_t *krnl)
+{
+  struct memphy_struct *mp;
+  int it, id, numslot;
+
+  printf("[SWAP STATS] Swap out: %lu | Direct: %lu | kswapd: %lu (wakeup %lu, wmark %d/%d)\n",
+         pgswapout_cnt, pgswapout_cnt - kswapd.nr_reclaim, kswapd.nr_reclaim,
+         kswapd.nr_wakeup, kswapd.wmark_low, kswapd.wmark_high);
+  printf("[SWAP STATS] Swap-in faults: %lu | Readahead: %lu | Hit: %lu (max window %d)\n",
+         swapin_fault_cnt, ra_issued_cnt, ra_hit_cnt, swap_ra_max);
+  if (swapio_cnt > 0)
+    printf("[SWAP STATS] Async swap-in: %lu | Device wait: %lu slots\n",
+           swapio_cnt, swapio_slots);
+  if (nr_swap_tier > 1)
+    printf("[SWAP STATS] Tiers: %d | Demoted: %lu | Kept hot: %lu\n",
+           nr_swap_tier, demote_cnt, hot_keep_cnt);
+
+  for (it = 0; it < nr_swap_dev; it++) {
+    id = swap_order[it];
+    numslot = krnl->mswp[id]->maxsz / PAGING_PAGESZ;
+    mp = krnl->mswp[id];
+    printf("[SWAP STATS] SWAP%d (class %d, prio %d): %d/%d slots used",
+           id, mp->swp_class, mp->swp_prio, numslot - mp->free_fp_cnt, numslot);
+    if (!mp->rdmflg)
+      printf(" | seq: %lu I/O, %lu seeks, avg seek %lu pages, time %lu",
+             mp->nr_io, mp->nr_seek,
+             mp->nr_seek ? mp->seek_dist / PAGING_PAGESZ / mp->nr_seek : 0,
+             mp->io_time);
+    printf("\n");
+    if (iosched_nr[id] > 0)
+      printf("[SWAP STATS] SWAP%d iosched %s: %lu requests, avg seek %lu slots, avg latency %lu\n",
+             id, iosched_name[mp->iosched], iosched_nr[id],
+             iosched_seek[id] / iosched_nr[id], iosched_lat[id] / iosched_nr[id]);
+  }
+}
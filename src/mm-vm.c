@@ -28,23 +28,91 @@
  */
 struct vm_area_struct *get_vma_by_num(struct mm_struct *mm, int vmaid)
 {
-  struct vm_area_struct *pvma = mm->mmap;
+  struct vm_area_struct *pvma;
 
-  if (mm->mmap == NULL)
-    return NULL;
+  for (pvma = mm->mmap; pvma != NULL; pvma = pvma->vm_next)
+    if (pvma->vm_id == vmaid)
+      return pvma;
 
-  int vmait = pvma->vm_id;
+  return NULL;
+}
 
-  while (vmait < vmaid)
-  {
-    if (pvma == NULL)
-      return NULL;
+/*vma_idx_floor - index of the last area starting before @addr, -1 if none
+ * As areas never overlap their ends are sorted too, so this one binary
+ * search answers both address lookups and overlap checks.
+ */
+static int vma_idx_floor(struct mm_struct *mm, addr_t addr)
+{
+  int lo = 0, hi = mm->nr_vma;
 
-    pvma = pvma->vm_next;
-    vmait = pvma->vm_id;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (mm->vma_idx[mid]->vm_start < addr)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
+  return lo - 1;
+}
+
+/*find_vma - get the vm area holding @addr, NULL if none */
+struct vm_area_struct *find_vma(struct mm_struct *mm, addr_t addr)
+{
+  int i = vma_idx_floor(mm, addr + 1);
+
+  if (i < 0 || !INCLUDE(addr, addr + 1, mm->vma_idx[i]->vm_start, mm->vma_idx[i]->vm_end))
+    return NULL;
+  return mm->vma_idx[i];
+}
+
+/*vma_overlap - whether [start,end) meets an area other than @skip */
+static int vma_overlap(struct mm_struct *mm, addr_t start, addr_t end,
+                       struct vm_area_struct *skip)
+{
+  int i = vma_idx_floor(mm, end);
 
-  return pvma;
+  if (i >= 0 && mm->vma_idx[i] == skip)
+    i--;
+  return i >= 0 && OVERLAP(start, end, mm->vma_idx[i]->vm_start, mm->vma_idx[i]->vm_end);
+}
+
+/*create_vm_area - add an empty area @vmaid growing up from @start
+ * Fail when the ID is taken or @start lies in the first page of, or
+ * inside, another area.
+ */
+struct vm_area_struct *create_vm_area(struct mm_struct *mm, int vmaid, addr_t start)
+{
+  struct vm_area_struct *vma, **pp, **idx;
+  int i;
+
+  if (get_vma_by_num(mm, vmaid) != NULL ||
+      vma_overlap(mm, start, start + PAGING_PAGESZ, NULL))
+    return NULL;
+
+  idx = realloc(mm->vma_idx, (mm->nr_vma + 1) * sizeof(*idx));
+  if (idx == NULL)
+    return NULL;
+  mm->vma_idx = idx;
+
+  vma = calloc(1, sizeof(struct vm_area_struct));
+  vma->vm_id = vmaid;
+  vma->vm_start = start;
+  vma->vm_end = start;
+  vma->sbrk = start;
+  vma->vm_mm = mm;
+
+  /* The list stays ordered by ID */
+  for (pp = &mm->mmap; *pp != NULL && (*pp)->vm_id < vmaid; pp = &(*pp)->vm_next)
+    ;
+  vma->vm_next = *pp;
+  *pp = vma;
+
+  i = vma_idx_floor(mm, start) + 1;
+  memmove(&idx[i + 1], &idx[i], (mm->nr_vma - i) * sizeof(*idx));
+  idx[i] = vma;
+  mm->nr_vma++;
+
+  return vma;
 }
 
 int __mm_swap_page(struct pcb_t *caller, addr_t vicfpn , addr_t swpfpn)
@@ -89,37 +157,21 @@ struct vm_rg_struct *get_vm_area_node_at_brk(struct pcb_t *caller, int vmaid, ad
  */
 int validate_overlap_vm_area(struct pcb_t *caller, int vmaid, addr_t vmastart, addr_t vmaend)
 {
-  //struct vm_area_struct *vma = caller->krnl->mm->mmap;
-
-  /* TODO validate the planned memory area is not overlapped */
   if (vmastart >= vmaend)
   {
     return -1;
   }
 
-  struct vm_area_struct *vma = caller->mm->mmap;
-  if (vma == NULL)
-  {
-    return -1;
-  }
-
-  /* TODO validate the planned memory area is not overlapped */
-
   struct vm_area_struct *cur_area = get_vma_by_num(caller->mm, vmaid);
   if (cur_area == NULL)
   {
     return -1;
   }
 
-  while (vma != NULL)
+  if (vma_overlap(caller->mm, vmastart, vmaend, cur_area))
   {
-    if (vma != cur_area && OVERLAP(vmastart, vmaend, vma->vm_start, vma->vm_end))
-    {
-      return -1;
-    }
-    vma = vma->vm_next;
+    return -1;
   }
-  /* End TODO*/
 
   return 0;
 }
@@ -138,6 +190,11 @@ int inc_vma_limit(struct pcb_t *caller, int vmaid, addr_t inc_sz)
   *      the raw inc_sz maybe not fit pagesize
   */
   struct vm_area_struct * cur_area = get_vma_by_num(caller->mm, vmaid);
+  if (cur_area == NULL) {
+    free(newrg);
+    pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
+    return -1;
+  }
   #ifdef MM64
   int pagesz = PAGING64_PAGESZ; // 4096 bytes
   #else
@@ -159,17 +216,14 @@ int inc_vma_limit(struct pcb_t *caller, int vmaid, addr_t inc_sz)
 
   struct vm_rg_struct *area = get_vm_area_node_at_brk(caller, vmaid, inc_sz, inc_amt);
   //area->rg_start = old_bound;
-  /* TODO Validate overlap of obtained region */
-  if (validate_overlap_vm_area(caller, vmaid, area->rg_start, area->rg_end) < 0){
+  /* The pages to map must not reach into another area */
+  if (validate_overlap_vm_area(caller, vmaid, old_bound, old_bound + inc_amt) < 0){
     free(newrg);
     free(area);
     pthread_mutex_unlock(&caller->krnl->mm->mm_lock);
     return -1;
   }/*Overlap and failed allocation */
 
-  /* TODO: Obtain the new vm area based on vmaid */
-  // cur_vma->vm_end... 
-  // inc_limit_ret...
   /* The obtained vm area (only)
     * now will be alloc real ram region */
 
@@ -178,6 +232,7 @@ int inc_vma_limit(struct pcb_t *caller, int vmaid, addr_t inc_sz)
     pthread_mutex_unlock(&caller->krnl->mm->mm_lock); 
     return -1; /* Map the memory to MEMRAM */
   }
+  cur_area->vm_end = old_bound + inc_amt;
 
   free(newrg);
   free(area);
@@ -186,4 +241,408 @@ int inc_vma_limit(struct pcb_t *caller, int vmaid, addr_t inc_sz)
   return 0;
 }
 
-// #endif
\ No newline at end of file
+/*
+ * Free regions of a vm area
+ *
+ * Every free region is a node of a treap ordered by start address, each
+ * node also records the largest free region of its subtree so that the
+ * lowest addressed region fitting a request is found in O(log n). A
+ * freed region is merged with its free neighbours on insertion. Regions
+ * smaller than FREERG_LARGE are also linked in a size class bin (class
+ * k holds sizes [2^(k+4), 2^(k+5))), which serves small requests without
+ * walking the treap. Callers hold the kernel mm_lock.
+ */
+
+static unsigned int freerg_seed = 1;
+
+static int freerg_bin(addr_t size)
+{
+  int bin = 0;
+
+  while (bin < FREERG_NR_BINS - 1 && size >= ((addr_t)32 << bin))
+    bin++;
+  return bin;
+}
+
+static void freerg_update(struct vm_freerg_struct *node)
+{
+  addr_t size = node->rg_end - node->rg_start;
+
+  node->max_size = size;
+  if (node->left != NULL && node->left->max_size > node->max_size)
+    node->max_size = node->left->max_size;
+  if (node->right != NULL && node->right->max_size > node->max_size)
+    node->max_size = node->right->max_size;
+}
+
+/* Split @t into the nodes starting before @key and the others */
+static void freerg_split(struct vm_freerg_struct *t, addr_t key,
+                         struct vm_freerg_struct **l, struct vm_freerg_struct **r)
+{
+  if (t == NULL) {
+    *l = *r = NULL;
+  } else if (t->rg_start < key) {
+    freerg_split(t->right, key, &t->right, r);
+    *l = t;
+    freerg_update(t);
+  } else {
+    freerg_split(t->left, key, l, &t->left);
+    *r = t;
+    freerg_update(t);
+  }
+}
+
+static struct vm_freerg_struct *freerg_merge(struct vm_freerg_struct *l,
+                                             struct vm_freerg_struct *r)
+{
+  if (l == NULL)
+    return r;
+  if (r == NULL)
+    return l;
+  if (l->prio > r->prio) {
+    l->right = freerg_merge(l->right, r);
+    freerg_update(l);
+    return l;
+  }
+  r->left = freerg_merge(l, r->left);
+  freerg_update(r);
+  return r;
+}
+
+static void freerg_bin_add(struct vm_area_struct *vma, struct vm_freerg_struct *node)
+{
+  node->bin = -1;
+  node->bin_prev = node->bin_next = NULL;
+  if (node->rg_end - node->rg_start >= FREERG_LARGE)
+    return;
+
+  node->bin = freerg_bin(node->rg_end - node->rg_start);
+  node->bin_next = vma->vm_freerg_bin[node->bin];
+  if (node->bin_next != NULL)
+    node->bin_next->bin_prev = node;
+  vma->vm_freerg_bin[node->bin] = node;
+}
+
+static void freerg_bin_del(struct vm_area_struct *vma, struct vm_freerg_struct *node)
+{
+  if (node->bin < 0)
+    return;
+  if (node->bin_prev != NULL)
+    node->bin_prev->bin_next = node->bin_next;
+  else
+    vma->vm_freerg_bin[node->bin] = node->bin_next;
+  if (node->bin_next != NULL)
+    node->bin_next->bin_prev = node->bin_prev;
+}
+
+/* Unlink @node (present in the treap) and release it */
+static void freerg_erase(struct vm_area_struct *vma, struct vm_freerg_struct *node)
+{
+  struct vm_freerg_struct *l, *m, *r;
+
+  freerg_bin_del(vma, node);
+  freerg_split(vma->vm_freerg_root, node->rg_start, &l, &m);
+  freerg_split(m, node->rg_start + 1, &m, &r);
+  vma->vm_freerg_root = freerg_merge(l, r);
+  free(node);
+}
+
+/*
+ * vm_freerg_insert - give [@start, @end) back to the free regions of
+ * @vma, merged with the free regions it touches
+ */
+int vm_freerg_insert(struct vm_area_struct *vma, addr_t start, addr_t end)
+{
+  struct vm_freerg_struct *node, *pred = NULL, *succ = NULL, *l, *r;
+
+  if (start >= end)
+    return -1;
+
+  /* Closest free regions below and above */
+  for (node = vma->vm_freerg_root; node != NULL; ) {
+    if (node->rg_start < start) {
+      pred = node;
+      node = node->right;
+    } else {
+      succ = node;
+      node = node->left;
+    }
+  }
+
+  if (pred != NULL && pred->rg_end == start) {
+    start = pred->rg_start;
+    freerg_erase(vma, pred);
+  }
+  if (succ != NULL && succ->rg_start == end) {
+    end = succ->rg_end;
+    freerg_erase(vma, succ);
+  }
+
+  node = malloc(sizeof(struct vm_freerg_struct));
+  node->rg_start = start;
+  node->rg_end = end;
+  node->left = node->right = NULL;
+  freerg_seed = freerg_seed * 1103515245 + 12345;
+  node->prio = freerg_seed;
+  freerg_update(node);
+  freerg_bin_add(vma, node);
+
+  freerg_split(vma->vm_freerg_root, start, &l, &r);
+  vma->vm_freerg_root = freerg_merge(freerg_merge(l, node), r);
+  return 0;
+}
+
+/*
+ * vm_freerg_lookup - get the bounds of the free region holding @addr
+ */
+int vm_freerg_lookup(struct vm_area_struct *vma, addr_t addr,
+                     addr_t *start, addr_t *end)
+{
+  struct vm_freerg_struct *node = vma->vm_freerg_root;
+
+  while (node != NULL) {
+    if (addr < node->rg_start) {
+      node = node->left;
+    } else if (addr >= node->rg_end) {
+      node = node->right;
+    } else {
+      *start = node->rg_start;
+      *end = node->rg_end;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/*
+ * vm_freerg_remove - take [@start, @end) out of the free region holding it
+ */
+int vm_freerg_remove(struct vm_area_struct *vma, addr_t start, addr_t end)
+{
+  struct vm_freerg_struct *node = vma->vm_freerg_root;
+  addr_t rg_start, rg_end;
+
+  while (node != NULL && (start < node->rg_start || start >= node->rg_end))
+    node = (start < node->rg_start) ? node->left : node->right;
+  if (node == NULL || end > node->rg_end)
+    return -1;
+
+  rg_start = node->rg_start;
+  rg_end = node->rg_end;
+  freerg_erase(vma, node);
+  if (rg_start < start)
+    vm_freerg_insert(vma, rg_start, start);
+  if (end < rg_end)
+    vm_freerg_insert(vma, end, rg_end);
+  return 0;
+}
+
+/*
+ * vm_freerg_alloc - carve @size bytes out of the free regions of @vma
+ * Small requests are served from the size class bins (first fit in their
+ * own class, any region of a larger class), the others by the lowest
+ * addressed free region large enough.
+ */
+int vm_freerg_alloc(struct vm_area_struct *vma, addr_t size, addr_t *start)
+{
+  struct vm_freerg_struct *node = NULL;
+  addr_t end;
+  int bin;
+
+  if (size == 0 || vma->vm_freerg_root == NULL ||
+      vma->vm_freerg_root->max_size < size)
+    return -1;
+
+  if (size < FREERG_LARGE) {
+    bin = freerg_bin(size);
+    for (node = vma->vm_freerg_bin[bin]; node != NULL; node = node->bin_next)
+      if (node->rg_end - node->rg_start >= size)
+        break;
+    for (bin++; node == NULL && bin < FREERG_NR_BINS; bin++)
+      node = vma->vm_freerg_bin[bin];
+  }
+
+  if (node == NULL) {
+    node = vma->vm_freerg_root;
+    while (1) {
+      if (node->left != NULL && node->left->max_size >= size)
+        node = node->left;
+      else if (node->rg_end - node->rg_start >= size)
+        break;
+      else
+        node = node->right;
+    }
+  }
+
+  *start = node->rg_start;
+  end = node->rg_end;
+  freerg_erase(vma, node);
+  if (*start + size < end)
+    vm_freerg_insert(vma, *start + size, end);
+
+  return 0;
+}
+
+/*
+ * vm_freerg_destroy - release the free region structures of @vma
+ */
+static void freerg_destroy(struct vm_freerg_struct *node)
+{
+  if (node == NULL)
+    return;
+  freerg_destroy(node->left);
+  freerg_destroy(node->right);
+  free(node);
+}
+
+void vm_freerg_destroy(struct vm_area_struct *vma)
+{
+  int bin;
+
+  freerg_destroy(vma->vm_freerg_root);
+  vma->vm_freerg_root = NULL;
+  for (bin = 0; bin < FREERG_NR_BINS; bin++)
+    vma->vm_freerg_bin[bin] = NULL;
+}
+
+/*
+ * Slab caches of a vm area
+ *
+ * Regions up to SLAB_MAX_OBJ bytes are rounded up to a power of two
+ * class and carved out of heap pages owned by the cache of that class,
+ * so small objects share frames instead of taking one each. A slab
+ * keeps its page when it becomes empty; the pages go away with the
+ * process. Callers hold the kernel mm_lock.
+ */
+
+static int slab_class(addr_t size)
+{
+  int cls = 0;
+
+  while (((addr_t)1 << (cls + SLAB_MIN_SHIFT)) < size)
+    cls++;
+  return cls;
+}
+
+/*
+ * vm_slab_alloc - take an object for a region of @size bytes
+ * Return -1 when the class has no free object left, the caller then
+ * grows the heap by a page and hands it over with vm_slab_add_page.
+ */
+int vm_slab_alloc(struct vm_area_struct *vma, addr_t size, addr_t *start)
+{
+  struct slab_struct *slab;
+  int cls, w, bit;
+
+  if (size == 0 || size > SLAB_MAX_OBJ)
+    return -1;
+
+  cls = slab_class(size);
+  for (slab = vma->vm_slab[cls]; slab != NULL; slab = slab->next)
+    if (slab->nr_free > 0)
+      break;
+  if (slab == NULL)
+    return -1;
+
+  for (w = 0; ~slab->map[w] == 0; w++)
+    ;
+  bit = __builtin_ctzll(~slab->map[w]);
+  slab->map[w] |= (uint64_t)1 << bit;
+  slab->nr_free--;
+
+  *start = slab->pg_start + ((addr_t)(w * 64 + bit) << (cls + SLAB_MIN_SHIFT));
+  return 0;
+}
+
+/*
+ * vm_slab_add_page - give the heap page at @pg_start to the cache
+ * serving regions of @size bytes
+ */
+void vm_slab_add_page(struct vm_area_struct *vma, addr_t size, addr_t pg_start)
+{
+  struct slab_struct *slab = calloc(1, sizeof(struct slab_struct));
+  int cls = slab_class(size);
+  int nr_obj = PAGING_PAGESZ >> (cls + SLAB_MIN_SHIFT);
+  int w;
+
+  slab->pg_start = pg_start;
+  slab->nr_free = nr_obj;
+  /* Bits past the last object of the page are never free */
+  for (w = nr_obj / 64; w < SLAB_MAP_WORDS; w++)
+    slab->map[w] = (w * 64 >= nr_obj) ? ~(uint64_t)0 : ~(uint64_t)0 << (nr_obj % 64);
+
+  slab->next = vma->vm_slab[cls];
+  vma->vm_slab[cls] = slab;
+}
+
+/*
+ * Slab whose page holds @start and its class, NULL if none. All classes
+ * are searched: a region shrunk in place no longer tells its class.
+ */
+static struct slab_struct *slab_lookup(struct vm_area_struct *vma, addr_t start, int *cls)
+{
+  struct slab_struct *slab;
+  addr_t pg_start = start & ~((addr_t)PAGING_PAGESZ - 1);
+
+  for (*cls = 0; *cls < SLAB_NR_CLASSES; (*cls)++)
+    for (slab = vma->vm_slab[*cls]; slab != NULL; slab = slab->next)
+      if (slab->pg_start == pg_start)
+        return slab;
+  return NULL;
+}
+
+/*
+ * vm_slab_objsz - size of the slab object backing the region at @start,
+ * 0 when the region does not come from a slab
+ */
+addr_t vm_slab_objsz(struct vm_area_struct *vma, addr_t start)
+{
+  int cls;
+
+  if (slab_lookup(vma, start, &cls) == NULL)
+    return 0;
+  return (addr_t)1 << (cls + SLAB_MIN_SHIFT);
+}
+
+/*
+ * vm_slab_free - return the object of the region at @start
+ * Return -1 when the region does not come from a slab, or @start is not
+ * an object in use.
+ */
+int vm_slab_free(struct vm_area_struct *vma, addr_t start)
+{
+  int cls, idx;
+  struct slab_struct *slab = slab_lookup(vma, start, &cls);
+  uint64_t bit;
+
+  if (slab == NULL)
+    return -1;
+
+  if ((start - slab->pg_start) & (((addr_t)1 << (cls + SLAB_MIN_SHIFT)) - 1))
+    return -1;
+  idx = (start - slab->pg_start) >> (cls + SLAB_MIN_SHIFT);
+  bit = (uint64_t)1 << (idx % 64);
+  if (!(slab->map[idx / 64] & bit))
+    return -1;
+  slab->map[idx / 64] &= ~bit;
+  slab->nr_free++;
+  return 0;
+}
+
+/*
+ * vm_slab_destroy - release the slab caches of @vma
+ */
+void vm_slab_destroy(struct vm_area_struct *vma)
+{
+  struct slab_struct *slab;
+  int cls;
+
+  for (cls = 0; cls < SLAB_NR_CLASSES; cls++) {
+    while ((slab = vma->vm_slab[cls]) != NULL) {
+      vma->vm_slab[cls] = slab->next;
+      free(slab);
+    }
+  }
+}
+
+// #endif
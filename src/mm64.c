@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h> 
 #include <pthread.h> 
+#include <assert.h>
 #include "../include/libmem.h"
 
 #if defined(MM64)
@@ -15,22 +16,11 @@
 
 int find_victim_page(struct mm_struct *mm, int *retpgn, struct pcb_t **ret_owner);
 
-/* __swap_cp_page: Copy dữ liệu giữa RAM và Swap Disk */
+/* __swap_cp_page: Copy dữ liệu giữa RAM và Swap Disk (một frame mỗi lần) */
 int __swap_cp_page(struct memphy_struct *mpsrc, addr_t srcfpn,
                    struct memphy_struct *mpdst, addr_t dstfpn)
 {
-  int cellidx;
-  addr_t addrsrc, addrdst;
-  for (cellidx = 0; cellidx < PAGING64_PAGESZ; cellidx++)
-  {
-    addrsrc = srcfpn * PAGING64_PAGESZ + cellidx;
-    addrdst = dstfpn * PAGING64_PAGESZ + cellidx;
-
-    BYTE data;
-    MEMPHY_read(mpsrc, addrsrc, &data);
-    MEMPHY_write(mpdst, addrdst, data);
-  }
-  return 0;
+  return MEMPHY_copy_frame(mpsrc, srcfpn, mpdst, dstfpn);
 }
 
 /* init_pte - Initialize PTE entry */
@@ -88,6 +78,8 @@ int pte_set_swap(struct pcb_t *caller, addr_t pgn, int swptyp, addr_t swpoff)
   addr_t pgd_idx = 0, p4d_idx = 0, pud_idx = 0, pmd_idx = 0, pt_idx = 0;
   int ret = 0;
 
+  /* Slots past the SWPOFF field would alias a lower slot */
+  assert(swpoff < PAGING_MAX_SWPOFF);
   pthread_mutex_lock(&mm->mm_lock);
 
 #ifdef MM64 
@@ -113,6 +105,7 @@ int pte_set_swap(struct pcb_t *caller, addr_t pgn, int swptyp, addr_t swpoff)
   
   CLRBIT(*pte, PAGING_PTE_PRESENT_MASK);
   SETBIT(*pte, PAGING_PTE_SWAPPED_MASK);
+  CLRBIT(*pte, PAGING_PTE_READAHEAD_MASK);
   SETVAL(*pte, swptyp, PAGING_PTE_SWPTYP_MASK, PAGING_PTE_SWPTYP_LOBIT);
   SETVAL(*pte, swpoff, PAGING_PTE_SWPOFF_MASK, PAGING_PTE_SWPOFF_LOBIT);
 
@@ -152,6 +145,8 @@ int pte_set_fpn(struct pcb_t *caller, addr_t pgn, addr_t fpn)
 
   SETBIT(*pte, PAGING_PTE_PRESENT_MASK);
   CLRBIT(*pte, PAGING_PTE_SWAPPED_MASK);
+  /* Drop the stale swap fields, they share bits with the frame number */
+  CLRBIT(*pte, PAGING_PTE_SWPOFF_MASK);
   SETVAL(*pte, fpn, PAGING_PTE_FPN_MASK, PAGING_PTE_FPN_LOBIT);
 
   pthread_mutex_unlock(&mm->mm_lock);
@@ -296,6 +291,42 @@ addr_t vmap_page_range(struct pcb_t *caller, addr_t addr, int pgnum,
   return 0;
 }
 
+/*
+ * alloc_pages_contig - take the frames of a range as one contiguous run
+ * The buddy allocator rounds the run up to a power of two, the tail is
+ * given back at once.
+ */
+static int alloc_pages_contig(struct pcb_t *caller, int req_pgnum, struct framephy_struct **frm_lst)
+{
+  int order = 0, pgit;
+  addr_t fpn;
+  struct framephy_struct *newfp_str;
+  struct framephy_struct *last_fp = NULL;
+
+  while ((1 << order) < req_pgnum)
+    order++;
+
+  if (MEMPHY_get_freefp_range(caller->krnl->mram, order, &fpn) < 0)
+    return -1;
+
+  for (pgit = req_pgnum; pgit < (1 << order); pgit++)
+    MEMPHY_put_freefp(caller->krnl->mram, fpn + pgit);
+
+  for (pgit = 0; pgit < req_pgnum; pgit++) {
+    newfp_str = malloc(sizeof(struct framephy_struct));
+    newfp_str->fpn = fpn + pgit;
+    newfp_str->fp_next = NULL;
+    newfp_str->owner = caller->mm;
+
+    if (last_fp == NULL) *frm_lst = newfp_str;
+    else last_fp->fp_next = newfp_str;
+    last_fp = newfp_str;
+  }
+
+  kswapd_wakeup(caller->krnl);
+  return 0;
+}
+
 /* alloc_pages_range */
 addr_t alloc_pages_range(struct pcb_t *caller, int req_pgnum, struct framephy_struct **frm_lst)
 {
@@ -304,6 +335,10 @@ addr_t alloc_pages_range(struct pcb_t *caller, int req_pgnum, struct framephy_st
   struct framephy_struct *newfp_str;
   struct framephy_struct *last_fp = NULL; 
 
+  /* Contiguous run first, scattered frames (with swap out) otherwise */
+  if (req_pgnum > 1 && alloc_pages_contig(caller, req_pgnum, frm_lst) == 0)
+    return 0;
+
   for(pgit = 0; pgit < req_pgnum; pgit++)
   {
     newfp_str = malloc(sizeof(struct framephy_struct));
@@ -313,29 +348,16 @@ addr_t alloc_pages_range(struct pcb_t *caller, int req_pgnum, struct framephy_st
     if (MEMPHY_get_freefp(caller->krnl->mram, &fpn) == 0) {
        newfp_str->fpn = fpn;
     } 
-    else { 
+    else if (swap_out_page(caller->krnl, &fpn) == 0) {
        // RAM đầy -> Swap Out (Global Replacement)
-       int vicpgn;
-       addr_t swpfpn;
-       struct pcb_t *vic_owner;
-       
-       if (find_victim_page(caller->krnl->mm, &vicpgn, &vic_owner) < 0) { 
-           printf("Error: OOM - Cannot find victim page\n");
-           free(newfp_str); 
-           return -3000;
-       }
-
-       uint32_t vicpte = pte_get_entry(vic_owner, vicpgn);
-       fpn = PAGING_FPN(vicpte); 
-
-       if (MEMPHY_get_freefp(caller->krnl->active_mswp, &swpfpn) < 0) {
-           free(newfp_str); return -3000;
-       }
-       
-       __swap_cp_page(caller->krnl->mram, fpn, caller->krnl->active_mswp, swpfpn);
-       pte_set_swap(vic_owner, vicpgn, 0, swpfpn);
        newfp_str->fpn = fpn;
     }
+    else {
+       printf("Error: OOM - Cannot find victim page\n");
+       free(newfp_str);
+       return -3000;
+    }
+    kswapd_wakeup(caller->krnl);
     
     if (*frm_lst == NULL) *frm_lst = newfp_str;
     else last_fp->fp_next = newfp_str;
@@ -362,37 +384,30 @@ addr_t vm_map_ram(struct pcb_t *caller, addr_t astart, addr_t aend, addr_t mapst
 /* init_mm */
 int init_mm(struct mm_struct *mm, struct pcb_t *caller)
 {
-  struct vm_area_struct *vma0 = malloc(sizeof(struct vm_area_struct));
-  if (vma0 == NULL) return -1; 
-
   mm->pgd = NULL;
   mm->p4d = NULL;
   mm->pud = NULL;
   mm->pmd = NULL;
   mm->pt  = NULL;
 
-  vma0->vm_id = 0;
-  vma0->vm_start = 0;
-  vma0->vm_end = vma0->vm_start;
-  vma0->sbrk = vma0->vm_start;
-  
-  vma0->vm_freerg_list = NULL; 
-
-  struct vm_rg_struct *first_rg = init_vm_rg(vma0->vm_start, vma0->vm_end);
-  enlist_vm_rg_node(&vma0->vm_freerg_list, first_rg);
-
-  vma0->vm_next = NULL;
-  vma0->vm_mm = mm;
-  mm->mmap = vma0;
+  mm->mmap = NULL;
+  mm->vma_idx = NULL;
+  mm->nr_vma = 0;
+  if (create_vm_area(mm, VMA_HEAP, 0) == NULL ||
+      create_vm_area(mm, VMA_MMAP, VMA_MMAP_BASE) == NULL ||
+      create_vm_area(mm, VMA_STACK, VMA_STACK_BASE) == NULL)
+    return -1;
 
-  for (int i = 0; i < PAGING_MAX_SYMTBL_SZ; i++) {
-     mm->symrgtbl[i].rg_start = 0;
-     mm->symrgtbl[i].rg_end = 0;
-     mm->symrgtbl[i].rg_next = NULL;
-  }
+  mm->symrgtbl = calloc(PAGING_SYMTBL_INIT_SZ, sizeof(struct vm_rg_struct));
+  mm->symrgtbl_sz = PAGING_SYMTBL_INIT_SZ;
 
   mm->fifo_pgn = NULL;
 
+  mm->ra_window = 2;
+  mm->ra_size = 0;
+  mm->ra_hit = 0;
+  mm->swapio_pgn = -1;
+
   pthread_mutexattr_t attr;
   pthread_mutexattr_init(&attr);
   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE_NP); 
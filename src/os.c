@@ -4,11 +4,14 @@
 #include "../include/os-sched.h"
 #include "../include/loader.h"
 #include "../include/mm.h"
+#include "../include/libmem.h"
+#include "../include/syscall.h"
 
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 static int time_slot;
 static int num_cpus;
@@ -17,8 +20,20 @@ static struct krnl_t os;
 
 #ifdef MM_PAGING
 
-static int memramsz;
-static int memswpsz[PAGING_MAX_MMSWP];
+static unsigned long memramsz;
+static unsigned long memswpsz[PAGING_MAX_MMSWP];
+static int kswapd_wmark[2] = {KSWAPD_WMARK_LOW, KSWAPD_WMARK_HIGH};
+static int memswptier[PAGING_MAX_MMSWP][2]; /* swap class, priority */
+/* Host backing of MEMRAM (index 0) and the MEMSWPs (index 1 + swap id) */
+static int memback[PAGING_MAX_MMSWP + 1];
+static char memback_path[PAGING_MAX_MMSWP + 1][100];
+/* Sequential swap devices: seek, rotation and transfer cost, 0 when random */
+static int memseq[PAGING_MAX_MMSWP];
+static unsigned long memseqcost[PAGING_MAX_MMSWP][3];
+static int memiosched[PAGING_MAX_MMSWP]; /* IOSCHED_* */
+/* NUMA nodes of MEMRAM and the cost of a remote access */
+static int numa_nodes = 1;
+static unsigned long numa_remote_cost;
 
 struct mmpaging_ld_args {
 	/* A dispatched argument struct to compact many-fields passing to loader */
@@ -43,12 +58,19 @@ int num_processes;
 struct cpu_args {
 	struct timer_id_t * timer_id;
 	int id;
+	/* Time slots spent running a process / with nothing to run */
+	unsigned long busy_slots;
+	unsigned long idle_slots;
 };
 
 
 static void * cpu_routine(void * args) {
 	struct timer_id_t * timer_id = ((struct cpu_args*)args)->timer_id;
 	int id = ((struct cpu_args*)args)->id;
+	struct cpu_args * stat = (struct cpu_args*)args;
+#ifdef MM_PAGING
+	MEMPHY_set_cpu(id);
+#endif
 	/* Check for new process in ready queue */
 	int time_left = 0;
 	struct pcb_t * proc = NULL;
@@ -58,7 +80,8 @@ static void * cpu_routine(void * args) {
 			/* No process is running, the we load new process from
 		 	* ready queue */
 			proc = get_proc();
-			if (proc == NULL) {
+			if (proc == NULL && !done) {
+                           stat->idle_slots++;
                            next_slot(timer_id);
                            continue; /* First load failed. skip dummy load */
                         }
@@ -66,6 +89,13 @@ static void * cpu_routine(void * args) {
 			/* The porcess has finish it job */
 			printf("\tCPU %d: Processed %2d has finished\n",
 				id ,proc->pid);
+			/* Entries queued but never entered still run */
+			libsyscall_flush(proc);
+			exit_proc(proc);
+#ifdef MM_PAGING
+			free_pcb_memph(proc);
+#endif
+			free(proc->sc_ring);
 			free(proc);
 			proc = get_proc();
 			time_left = 0;
@@ -78,13 +108,19 @@ static void * cpu_routine(void * args) {
 		}
 		
 		/* Recheck process status after loading new process */
-		if (proc == NULL && done) {
+		if (proc == NULL && done && blocked_procs() == 0) {
+			/* A process woken up by swap I/O may have been queued
+			 * right after the last get_proc() */
+			proc = get_proc();
+		}
+		if (proc == NULL && done && blocked_procs() == 0) {
 			/* No process to run, exit */
 			printf("\tCPU %d stopped\n", id);
 			break;
 		}else if (proc == NULL) {
 			/* There may be new processes to run in
 			 * next time slots, just skip current slot */
+			stat->idle_slots++;
 			next_slot(timer_id);
 			continue;
 		}else if (time_left == 0) {
@@ -94,7 +130,21 @@ static void * cpu_routine(void * args) {
 		}
 		
 		/* Run current process */
+#ifdef MM_PAGING
+		if (run(proc) == PAGING_SWAP_PENDING) {
+			/* Swap-in fault, dispatch another process meanwhile */
+			printf("\tCPU %d: Process %2d blocked on swap I/O\n",
+				id, proc->pid);
+			block_proc(proc);
+			swap_io_submit(proc);
+			proc = NULL;
+			time_left = 0;
+			continue;
+		}
+#else
 		run(proc);
+#endif
+		stat->busy_slots++;
 		time_left--;
 		next_slot(timer_id);
 	}
@@ -106,7 +156,6 @@ static void * ld_routine(void * args) {
 #ifdef MM_PAGING
     struct memphy_struct* mram = ((struct mmpaging_ld_args *)args)->mram;
     struct memphy_struct** mswp = ((struct mmpaging_ld_args *)args)->mswp;
-    struct memphy_struct* active_mswp = ((struct mmpaging_ld_args *)args)->active_mswp;
     struct timer_id_t * timer_id = ((struct mmpaging_ld_args *)args)->timer_id;
 #else
     struct timer_id_t * timer_id = (struct timer_id_t*)args;
@@ -135,7 +184,6 @@ static void * ld_routine(void * args) {
         krnl->mm = global_mm;
         krnl->mram = mram;
         krnl->mswp = mswp;
-        krnl->active_mswp = active_mswp;
 #endif
         printf("\tLoaded a process at %s, PID: %d PRIO: %ld\n",
             ld_processes.path[i], proc->pid, ld_processes.prio[i]);
@@ -151,6 +199,115 @@ static void * ld_routine(void * args) {
     pthread_exit(NULL);
 }
 
+#ifdef MM_PAGING
+/*
+ * read_directives - optional tuning lines between the memory sizes and
+ * the process list. A directive starts with a keyword, a process line
+ * starts with its (numeric) start time.
+ *        kswapd LOW_PCT HIGH_PCT
+ *        readahead MAX_PAGES
+ *        swap SWAP_ID CLASS PRIO  (CLASS: nvme, ssd, hdd or a number)
+ *        memphy ram|swpN heap|anon|file [PATH]
+ *        seqdev swpN SEEK ROT XFER
+ *        iosched swpN fcfs|sstf|scan|clook|deadline
+ *        numa NODES REMOTE_COST
+ */
+static int memphy_dev_id(const char * dev) {
+	if (!strcmp(dev, "ram"))
+		return 0;
+	if (!strncmp(dev, "swp", 3) && isdigit(dev[3]) &&
+	    dev[3] - '0' < PAGING_MAX_MMSWP)
+		return 1 + dev[3] - '0';
+	return -1;
+}
+
+static void read_directives(FILE * file) {
+	char key[32];
+	int c;
+
+	while ((c = fgetc(file)) != EOF) {
+		if (isspace(c))
+			continue;
+		ungetc(c, file);
+		if (!isalpha(c))
+			break;
+
+		fscanf(file, "%31s", key);
+		if (!strcmp(key, "kswapd")) {
+			fscanf(file, "%d %d", &kswapd_wmark[0], &kswapd_wmark[1]);
+		} else if (!strcmp(key, "readahead")) {
+			int ramax;
+			fscanf(file, "%d", &ramax);
+			swap_set_readahead(ramax);
+		} else if (!strcmp(key, "swap")) {
+			char cls[16];
+			int sid, prio;
+			fscanf(file, "%d %15s %d", &sid, cls, &prio);
+			if (sid < 0 || sid >= PAGING_MAX_MMSWP) {
+				printf("Invalid swap device: %d\n", sid);
+				exit(1);
+			}
+			if (!strcmp(cls, "nvme"))
+				memswptier[sid][0] = 0;
+			else if (!strcmp(cls, "ssd"))
+				memswptier[sid][0] = 1;
+			else if (!strcmp(cls, "hdd"))
+				memswptier[sid][0] = 2;
+			else
+				memswptier[sid][0] = atoi(cls);
+			memswptier[sid][1] = prio;
+		} else if (!strcmp(key, "memphy")) {
+			char dev[16], back[16];
+			int mid;
+			fscanf(file, "%15s %15s", dev, back);
+			mid = memphy_dev_id(dev);
+			if (mid < 0) {
+				printf("Invalid memphy device: %s\n", dev);
+				exit(1);
+			}
+			if (!strcmp(back, "heap")) {
+				memback[mid] = MEMPHY_BACK_HEAP;
+			} else if (!strcmp(back, "anon")) {
+				memback[mid] = MEMPHY_BACK_ANON;
+			} else if (!strcmp(back, "file")) {
+				memback[mid] = MEMPHY_BACK_FILE;
+				fscanf(file, "%99s", memback_path[mid]);
+			} else {
+				printf("Invalid memphy backing: %s\n", back);
+				exit(1);
+			}
+		} else if (!strcmp(key, "seqdev")) {
+			char dev[16];
+			int mid;
+			fscanf(file, "%15s", dev);
+			mid = memphy_dev_id(dev);
+			if (mid < 1) {
+				printf("Invalid sequential device: %s\n", dev);
+				exit(1);
+			}
+			memseq[mid - 1] = 1;
+			fscanf(file, "%lu %lu %lu", &memseqcost[mid - 1][0],
+			       &memseqcost[mid - 1][1], &memseqcost[mid - 1][2]);
+		} else if (!strcmp(key, "iosched")) {
+			char dev[16], policy[16];
+			int mid;
+			fscanf(file, "%15s %15s", dev, policy);
+			mid = memphy_dev_id(dev);
+			if (mid < 1 || swap_iosched_id(policy) < 0) {
+				printf("Invalid iosched: %s %s\n", dev, policy);
+				exit(1);
+			}
+			memiosched[mid - 1] = swap_iosched_id(policy);
+		} else if (!strcmp(key, "numa")) {
+			fscanf(file, "%d %lu", &numa_nodes, &numa_remote_cost);
+		} else {
+			printf("Unknown config directive: %s\n", key);
+			exit(1);
+		}
+	}
+}
+#endif
+
 static void read_config(const char * path) {
 	FILE * file;
 	if ((file = fopen(path, "r")) == NULL) {
@@ -178,12 +335,13 @@ static void read_config(const char * path) {
 	 * Format: (size=0 result non-used memswap, must have RAM and at least 1 SWAP)
 	 *        MEM_RAM_SZ MEM_SWP0_SZ MEM_SWP1_SZ MEM_SWP2_SZ MEM_SWP3_SZ
 	*/
-	fscanf(file, "%d\n", &memramsz);
+	fscanf(file, "%lu\n", &memramsz);
 	for(sit = 0; sit < PAGING_MAX_MMSWP; sit++)
-		fscanf(file, "%d", &(memswpsz[sit])); 
+		fscanf(file, "%lu", &(memswpsz[sit])); 
 
        fscanf(file, "\n"); /* Final character */
 #endif
+	read_directives(file);
 #endif
 
 #ifdef MLQ_SCHED
@@ -227,6 +385,8 @@ int main(int argc, char * argv[]) {
 	for (i = 0; i < num_cpus; i++) {
 		args[i].timer_id = attach_event();
 		args[i].id = i;
+		args[i].busy_slots = 0;
+		args[i].idle_slots = 0;
 	}
 	struct timer_id_t * ld_event = attach_event();
 	start_timer();
@@ -237,25 +397,74 @@ int main(int argc, char * argv[]) {
 
 	struct memphy_struct mram;
 	struct memphy_struct mswp[PAGING_MAX_MMSWP];
+	struct memphy_struct *mswp_list[PAGING_MAX_MMSWP];
 
-	/* Create MEM RAM */
-	init_memphy(&mram, memramsz, rdmflag);
+	/* Create MEM RAM, every frame must fit the PTE frame number */
+	if (memramsz > (unsigned long)PAGING_MAX_FPN * PAGING_PAGESZ) {
+		printf("MEMRAM clamped to %lu bytes\n",
+		       (unsigned long)PAGING_MAX_FPN * PAGING_PAGESZ);
+		memramsz = (unsigned long)PAGING_MAX_FPN * PAGING_PAGESZ;
+	}
+	if (init_memphy_backed(&mram, memramsz, rdmflag,
+	                       memback[0], memback_path[0]) < 0) {
+		printf("Cannot create MEMRAM\n");
+		exit(1);
+	}
+	if (numa_nodes > 1 &&
+	    MEMPHY_numa_init(&mram, numa_nodes, num_cpus, numa_remote_cost) < 0)
+		printf("Cannot split MEMRAM into %d NUMA nodes\n", numa_nodes);
+	MEMPHY_buddy_init(&mram, BUDDY_MAX_ORDER);
+	MEMPHY_mag_init(&mram, num_cpus);
 
         /* Create all MEM SWAP */ 
 	int sit;
-	for(sit = 0; sit < PAGING_MAX_MMSWP; sit++)
-	       init_memphy(&mswp[sit], memswpsz[sit], rdmflag);
+	for(sit = 0; sit < PAGING_MAX_MMSWP; sit++) {
+	       /* Every slot must fit the PTE swap offset */
+	       if (memswpsz[sit] > (unsigned long)PAGING_MAX_SWPOFF * PAGING_PAGESZ) {
+		       printf("MEMSWP%d clamped to %lu bytes\n", sit,
+		              (unsigned long)PAGING_MAX_SWPOFF * PAGING_PAGESZ);
+		       memswpsz[sit] = (unsigned long)PAGING_MAX_SWPOFF * PAGING_PAGESZ;
+	       }
+	       if (init_memphy_backed(&mswp[sit], memswpsz[sit], !memseq[sit],
+	                              memback[1 + sit], memback_path[1 + sit]) < 0) {
+		       printf("Cannot create MEMSWP%d\n", sit);
+		       exit(1);
+	       }
+	       MEMPHY_set_cost(&mswp[sit], memseqcost[sit][0],
+	                       memseqcost[sit][1], memseqcost[sit][2]);
+	       mswp[sit].swp_class = memswptier[sit][0];
+	       mswp[sit].swp_prio = memswptier[sit][1];
+	       mswp[sit].iosched = memiosched[sit];
+	       mswp_list[sit] = &mswp[sit];
+	}
 
 	/* In Paging mode, it needs passing the system mem to each PCB through loader*/
 	struct mmpaging_ld_args *mm_ld_args = malloc(sizeof(struct mmpaging_ld_args));
 
 	mm_ld_args->timer_id = ld_event;
 	mm_ld_args->mram = (struct memphy_struct *) &mram;
-	mm_ld_args->mswp = (struct memphy_struct**) &mswp;
+	mm_ld_args->mswp = mswp_list;
 	mm_ld_args->active_mswp = (struct memphy_struct *) &mswp[0];
     mm_ld_args->active_mswp_id = 0;
+
+	/* Kernel threads (kswapd) run before the first process is loaded */
+	os.mram = mm_ld_args->mram;
+	os.mswp = mm_ld_args->mswp;
+	os.active_mswp = mm_ld_args->active_mswp;
+	os.active_mswp_id = mm_ld_args->active_mswp_id;
+	swap_init(&os);
+#ifdef MM_SWAP_ASYNC
+	swap_io_start(&os);
+#endif
+#ifdef MM_KSWAPD
+	kswapd_start(&os, kswapd_wmark[0], kswapd_wmark[1]);
+#endif
 #endif
 
+	/* PID -> PCB table, the loader hands out pids 1..num_processes */
+	os.pid_tbl = calloc(num_processes + 1, sizeof(struct pcb_t *));
+	os.pid_tbl_sz = num_processes + 1;
+
 	/* Init scheduler */
 	init_scheduler();
 
@@ -279,6 +488,29 @@ int main(int argc, char * argv[]) {
 	/* Stop timer */
 	stop_timer();
 
+	for (i = 0; i < num_cpus; i++) {
+		unsigned long total = args[i].busy_slots + args[i].idle_slots;
+		printf("[CPU STATS] CPU %d: busy %lu | idle %lu | utilization %.2f%%\n",
+		       i, args[i].busy_slots, args[i].idle_slots,
+		       total ? 100.0 * args[i].busy_slots / total : 0.0);
+	}
+
+#ifdef MM_PAGING
+#ifdef MM_SWAP_ASYNC
+	swap_io_stop();
+#endif
+#ifdef MM_KSWAPD
+	kswapd_stop();
+#endif
+	swap_print_stats(&os);
+	MEMPHY_print_stats(&mram, "RAM");
+
+	release_memphy(&mram);
+	for (sit = 0; sit < PAGING_MAX_MMSWP; sit++)
+		release_memphy(&mswp[sit]);
+#endif
+	free(os.pid_tbl);
+
 	return 0;
 
 }
@@ -21,11 +21,22 @@ static pthread_mutex_t queue_lock;					//mutual exclusion
 
 static struct queue_t running_list;
 
+/* Processes waiting for swap I/O */
+static struct queue_t blocked_queue;
+
 #ifdef MLQ_SCHED
 static struct queue_t mlq_ready_queue[MAX_PRIO];	//mang cac queue dua vao priority
 static int slot[MAX_PRIO];							//thoi gian max 1 priority duoc chay
 #endif
 
+/* Register proc under its pid, caller holds queue_lock */
+static void pid_tbl_set(struct pcb_t * proc, struct pcb_t * val) {
+	struct krnl_t * krnl = proc->krnl;
+
+	if (krnl->pid_tbl != NULL && proc->pid < krnl->pid_tbl_sz)
+		krnl->pid_tbl[proc->pid] = val;
+}
+
 int queue_empty(void) {
 #ifdef MLQ_SCHED
 	unsigned long prio;
@@ -48,6 +59,7 @@ void init_scheduler(void) {
 	ready_queue.size = 0;
 	run_queue.size = 0;
 	running_list.size = 0;
+	blocked_queue.size = 0;
 	pthread_mutex_init(&queue_lock, NULL);
 }
 
@@ -103,6 +115,7 @@ void put_mlq_proc(struct pcb_t * proc) {
 	pthread_mutex_lock(&queue_lock);
 
 	//2. dua vao hang doi
+	purgequeue(&running_list, proc);
 	enqueue(&mlq_ready_queue[proc->prio], proc);
 	
 	pthread_mutex_unlock(&queue_lock);
@@ -122,6 +135,7 @@ void add_mlq_proc(struct pcb_t * proc) {
 	pthread_mutex_lock(&queue_lock);
 
 	//2. xep vao hang doi
+	pid_tbl_set(proc, proc);
 	enqueue(&mlq_ready_queue[proc->prio], proc);
 
 	pthread_mutex_unlock(&queue_lock);	
@@ -163,6 +177,7 @@ void put_proc(struct pcb_t * proc) {
 	 */
 
 	pthread_mutex_lock(&queue_lock);
+	purgequeue(&running_list, proc);
 	enqueue(&run_queue, proc);
 	pthread_mutex_unlock(&queue_lock);
 }
@@ -177,7 +192,53 @@ void add_proc(struct pcb_t * proc) {
 	 */
 
 	pthread_mutex_lock(&queue_lock);
+	pid_tbl_set(proc, proc);
 	enqueue(&ready_queue, proc);
 	pthread_mutex_unlock(&queue_lock);	
 }
-#endif
\ No newline at end of file
+#endif
+
+/*
+ * exit_proc - forget a finished process, its pid no longer resolves
+ */
+void exit_proc(struct pcb_t * proc) {
+	pthread_mutex_lock(&queue_lock);
+	purgequeue(&running_list, proc);
+	pid_tbl_set(proc, NULL);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/*
+ * block_proc - park a process until wake_proc() is called on it
+ */
+void block_proc(struct pcb_t * proc) {
+	pthread_mutex_lock(&queue_lock);
+	purgequeue(&running_list, proc);
+	enqueue(&blocked_queue, proc);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/*
+ * wake_proc - move a blocked process back to its ready queue, done under
+ * queue_lock so it is always accounted either as blocked or as ready
+ */
+void wake_proc(struct pcb_t * proc) {
+	pthread_mutex_lock(&queue_lock);
+	purgequeue(&blocked_queue, proc);
+#ifdef MLQ_SCHED
+	enqueue(&mlq_ready_queue[proc->prio], proc);
+#else
+	enqueue(&run_queue, proc);
+#endif
+	pthread_mutex_unlock(&queue_lock);
+}
+
+int blocked_procs(void) {
+	int nr;
+
+	pthread_mutex_lock(&queue_lock);
+	nr = blocked_queue.size;
+	pthread_mutex_unlock(&queue_lock);
+
+	return nr;
+}
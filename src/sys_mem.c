@@ -22,11 +22,16 @@
 
 typedef char BYTE;
 
-int __sys_memmap(struct krnl_t *krnl, uint32_t pid, struct sc_regs* regs)
+/*
+ * memmap_op - carry out memmap request @regs of @caller, shared by the
+ * memmap syscall and the batched entries of the syscall ring
+ */
+int memmap_op(struct pcb_t *caller, struct sc_regs *regs)
 {
-
     int memop = regs->a1;
     BYTE value;
+    int ret = 0;
+    uint64_t wide;
    
     /* TODO THIS DUMMY CREATE EMPTY PROC TO AVOID COMPILER NOTIFY 
         *      need to be eliminated
@@ -47,38 +52,67 @@ int __sys_memmap(struct krnl_t *krnl, uint32_t pid, struct sc_regs* regs)
         /* user process are not allowed to access directly pcb in kernel space of syscall */
         //....
 
-    struct queue_t *running_list = krnl->running_list;
-    struct pcb_t *caller;
-    for(int i = 0; i < running_list->size; i++){
-        if(running_list->proc[i]->pid == pid){
-            caller = running_list->proc[i];
-        }
-    }
-        
     switch (memop) {
     case SYSMEM_MAP_OP:
                 /* Reserved process case*/
                 vmap_pgd_memset(caller, regs->a2, regs->a3);
                 break;
     case SYSMEM_INC_OP:
-                inc_vma_limit(caller, regs->a2, regs->a3);
+                ret = inc_vma_limit(caller, regs->a2, regs->a3);
                 break;
     case SYSMEM_SWP_OP:
                 __mm_swap_page(caller, regs->a2, regs->a3);
                 break;
     case SYSMEM_IO_READ:
-                MEMPHY_read(caller->krnl->mram, regs->a2, &value);
-                regs->a3 = value;
+                /* a4: access width in bytes, 0 (unset) reads one byte */
+                if (regs->a4 > 8) {
+                    ret = -1;
+                    break;
+                }
+                if (regs->a4 > 1) {
+                    ret = MEMPHY_read_wide(caller->krnl->mram, regs->a2, regs->a4, &wide);
+                    if (ret == 0)
+                        regs->a3 = wide;
+                    break;
+                }
+                ret = MEMPHY_read(caller->krnl->mram, regs->a2, &value);
+                if (ret == 0)
+                    regs->a3 = value;
                 break;
     case SYSMEM_IO_WRITE:
-                MEMPHY_write(caller->krnl->mram, regs->a2, regs->a3);
+                if (regs->a4 > 8) {
+                    ret = -1;
+                    break;
+                }
+                if (regs->a4 > 1) {
+                    ret = MEMPHY_write_wide(caller->krnl->mram, regs->a2, regs->a4, regs->a3);
+                    break;
+                }
+                ret = MEMPHY_write(caller->krnl->mram, regs->a2, regs->a3);
+                break;
+    case SYSMEM_IO_COPY:
+                /* a2: destination, a3: source, a4: length */
+                ret = MEMPHY_copy(caller->krnl->mram, regs->a2, regs->a3, regs->a4);
+                break;
+    case SYSMEM_IO_SET:
+                /* a2: address, a3: byte value, a4: length */
+                ret = MEMPHY_set(caller->krnl->mram, regs->a2, regs->a3, regs->a4);
                 break;
     default:
                 printf("Memop code: %d\n", memop);
                 break;
     }
     
-    return 0;
+    return ret;
+}
+
+int __sys_memmap(struct krnl_t *krnl, uint32_t pid, struct sc_regs* regs)
+{
+    struct pcb_t *caller = get_caller(krnl, pid);
+    if (caller == NULL)
+        return -1;
+
+    return memmap_op(caller, regs);
 }
 
 
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 pdnguyen of HCMC University of Technology VNU-HCM
+ */
+
+/* LamiaAtrium release
+ * Source Code License Grant: The authors hereby grant to Licensee
+ * personal permission to use and modify the Licensed Source Code
+ * for the sole purpose of studying while attending the course CO2018.
+ */
+
+#include "../include/syscall.h"
+#include "../include/mm.h"
+#include <pthread.h>
+
+/*
+ * __sys_scring - run every entry queued on the syscall ring of the caller
+ * in a single kernel entry. The caller is resolved and the memory manager
+ * locked once for the whole batch; memmap entries go straight to their
+ * handler, any other number through the regular dispatch.
+ * Returns the number of entries completed.
+ */
+int __sys_scring(struct krnl_t *krnl, uint32_t pid, struct sc_regs *reg)
+{
+   struct pcb_t *caller = get_caller(krnl, pid);
+   struct sc_ring *ring;
+   struct sc_regs *sqe;
+   struct sc_cqe *cqe;
+   int nr = 0;
+
+   if (caller == NULL || (ring = caller->sc_ring) == NULL)
+      return -1;
+
+   pthread_mutex_lock(&krnl->mm->mm_lock);
+   while (ring->sq_head != ring->sq_tail &&
+          ring->cq_tail - ring->cq_head < SC_RING_SZ) {
+      sqe = &ring->sqe[ring->sq_head & (SC_RING_SZ - 1)];
+      cqe = &ring->cqe[ring->cq_tail & (SC_RING_SZ - 1)];
+
+      cqe->idx = ring->sq_head & (SC_RING_SZ - 1);
+      if (sqe->orig_ax == 17)
+         cqe->ret = memmap_op(caller, sqe);
+      else if (sqe->orig_ax == 18)
+         cqe->ret = -1; /* no nested rings */
+      else
+         cqe->ret = syscall(krnl, pid, sqe->orig_ax, sqe);
+
+      ring->sq_head++;
+      ring->cq_tail++;
+      nr++;
+   }
+   pthread_mutex_unlock(&krnl->mm->mm_lock);
+
+   return nr;
+}
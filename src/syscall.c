@@ -36,6 +36,17 @@ int __sys_ni_syscall(struct krnl_t *krnl, struct sc_regs *regs)
    return 0;
 }
 
+/*
+ * get_caller - resolve the calling pid through the kernel PID table.
+ * The caller is running on this CPU, so its slot cannot change under us.
+ */
+struct pcb_t *get_caller(struct krnl_t *krnl, uint32_t pid)
+{
+	if (krnl->pid_tbl == NULL || pid >= krnl->pid_tbl_sz)
+		return NULL;
+	return krnl->pid_tbl[pid];
+}
+
 #define __SYSCALL(nr, sym) case nr: return __##sym(krnl,pid,regs);
 int syscall(struct krnl_t *krnl, uint32_t pid, uint32_t nr, struct sc_regs* regs)
 {